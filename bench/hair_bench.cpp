@@ -0,0 +1,607 @@
+// hair_bench: throughput of the CPU hair solvers.
+//
+// Sweeps strand counts, vertices per strand and constraint iteration counts over
+// the solver backends: the scalar glm::vec4 port of HairSimulation.comp
+// (simulateHairReference), the structure-of-arrays HairSolver and the
+// strand-lockstep HairSolverSimd for every instruction set this CPU supports,
+// single threaded and on a StrandScheduler.
+//
+// Every measurement runs warm-up steps first and then a number of timed
+// repetitions of a number of steps. The median repetition gives strands per
+// second, nanoseconds per vertex-iteration (one vertex through one local shape or
+// length constraint iteration) and the bandwidth of the state a step has to touch.
+// The results are printed as a table, or as CSV or JSON for tracking regressions.
+// The SIMD backends are also checked against HairSolver; a deviation beyond
+// --max-deviation fails the run with exit code 1.
+//
+// --golden-record <file> stores the state of the reference solver after
+// --golden-steps steps of the first configuration as a HairSnapshot,
+// --golden-check <file> runs every selected solver as long on the configuration of
+// the snapshot and fails if one of them drifts from it beyond the tolerances.
+//
+// usage: hair_bench [options], see printUsage()
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HairSolver.h"
+#include "HairSolverSimd.h"
+#include "HairSnapshot.h"
+#include "StrandScheduler.h"
+
+enum BenchBackend {
+    BENCH_REFERENCE,       // simulateHairReference
+    BENCH_SOA,             // HairSolver
+    BENCH_SIMD,            // HairSolverSimd with a given instruction set
+    BENCH_SOA_THREADED,    // HairSolver on the scheduler
+    BENCH_SIMD_THREADED    // HairSolverSimd with the best instruction set on the scheduler
+};
+
+struct BenchSolver
+{
+    std::string name;
+    BenchBackend backend;
+    HairSimdInstructionSet instructionSet;
+};
+
+struct BenchOptions
+{
+    std::vector<int> strands = { 1000, 10000, 100000, 1000000 };
+    std::vector<int> verticesPerStrand = { 8, 16, 32, 64 };
+    std::vector<int> iterations = { 5 };     // local shape and length constraint iterations
+    std::vector<std::string> solvers;       // names of getSolvers(), empty for all
+    HairLengthConstraintMode lengthConstraintMode = HAIR_LENGTH_ITERATIVE;
+    int warmupSteps = 2;
+    int repetitions = 5;
+    int steps = 0;                          // steps per repetition, 0 sizes them by vertexStepsPerRepetition
+    double vertexStepsPerRepetition = 1 << 24;
+    int threads = 0;                        // workers of the threaded backends, 0 for one per hardware thread
+    double maxMemoryMb = 2048.0;            // larger configurations are skipped
+    std::string format = "table";           // table, csv or json
+    double maxDeviation = 1e-5;             // of a SIMD backend from HairSolver, larger ones fail the run
+    std::string goldenRecordPath;
+    std::string goldenCheckPath;
+    int goldenSteps = 60;
+    HairSnapshotTolerances goldenTolerances;
+};
+
+// Times of the repetitions of one measurement, in seconds per step
+struct BenchStatistics
+{
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+};
+
+struct BenchResult
+{
+    const BenchSolver* solver;
+    int threads;
+    int strands;
+    int verticesPerStrand;
+    int iterations;
+    int steps;
+    BenchStatistics statistics;
+    double strandsPerSecond;
+    double nsPerVertexIteration;
+    double gigabytesPerSecond;
+    double maxDeviation; // from HairSolver after a few steps, SIMD backends only, -1 otherwise
+};
+
+// Strands growing out of a sphere of radius 2 along its normal, in the layout of
+// createMasterHairs() (the roots are spread with a Fibonacci lattice instead of
+// taken from a Sphere, which needs a GL context).
+static std::vector<float> createHairData(int noOfMasterHairs, int verticesPerStrand, float hairStrandLength)
+{
+    std::vector<float> hairData((size_t)noOfMasterHairs * verticesPerStrand * 4);
+    const float goldenAngle = 3.14159265f * (3.f - std::sqrt(5.f));
+    size_t index = 0;
+    for(int strand = 0; strand < noOfMasterHairs; strand++) {
+        float z = 1.f - 2.f * (strand + 0.5f) / noOfMasterHairs;
+        float r = std::sqrt(1.f - z * z);
+        glm::vec4 rootNormal(r * std::cos(goldenAngle * strand), r * std::sin(goldenAngle * strand), z, 0.f);
+        glm::vec4 rootPos = glm::vec4(0.f, 0.f, 0.f, 1.f) + 2.f * rootNormal;
+        for(int vert = 0; vert < verticesPerStrand; vert++) {
+            glm::vec4 pos = vert == 0 ? rootPos : rootPos + (vert - 1) * hairStrandLength * rootNormal;
+            hairData[index++] = pos.x;
+            hairData[index++] = pos.y;
+            hairData[index++] = pos.z;
+            hairData[index++] = pos.w;
+        }
+    }
+    return hairData;
+}
+
+static std::vector<BenchSolver> getSolvers()
+{
+    std::vector<BenchSolver> solvers;
+    solvers.push_back({ "reference", BENCH_REFERENCE, HAIR_SIMD_GENERIC });
+    solvers.push_back({ "soa", BENCH_SOA, HAIR_SIMD_GENERIC });
+    const HairSimdInstructionSet instructionSets[] = { HAIR_SIMD_GENERIC, HAIR_SIMD_SSE, HAIR_SIMD_AVX2, HAIR_SIMD_AVX512 };
+    for(HairSimdInstructionSet instructionSet : instructionSets)
+        if(HairSolverSimd::isSupported(instructionSet))
+            solvers.push_back({ std::string("simd-") + HairSolverSimd::getName(instructionSet), BENCH_SIMD, instructionSet });
+    solvers.push_back({ "soa-mt", BENCH_SOA_THREADED, HAIR_SIMD_GENERIC });
+    solvers.push_back({ "simd-mt", BENCH_SIMD_THREADED, HairSolverSimd::getBestInstructionSet() });
+    return solvers;
+}
+
+// Bytes of solver state per vertex: the vec4 arrays of the reference, x, y and z
+// of the rest and three position buffers otherwise (SIMD blocks pad to full lanes)
+static double getStateBytesPerVertex(const BenchSolver& solver)
+{
+    return solver.backend == BENCH_REFERENCE ? 4 * sizeof(glm::vec4) : 4 * 3 * sizeof(float);
+}
+
+static BenchStatistics getStatistics(std::vector<double> times)
+{
+    BenchStatistics statistics;
+    if(times.empty())
+        return statistics;
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    statistics.min = times.front();
+    statistics.median = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    double sum = 0.0;
+    for(double time : times)
+        sum += time;
+    statistics.mean = sum / n;
+    double squares = 0.0;
+    for(double time : times)
+        squares += (time - statistics.mean) * (time - statistics.mean);
+    statistics.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    return statistics;
+}
+
+// Warm-up steps, then repetitions of steps timed one by one, in seconds per step
+template <class Step>
+static std::vector<double> timeRepetitions(const BenchOptions& options, int steps, Step step)
+{
+    for(int i = 0; i < options.warmupSteps; i++)
+        step();
+    std::vector<double> times;
+    for(int repetition = 0; repetition < options.repetitions; repetition++) {
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < steps; i++)
+            step();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double>(end - start).count() / steps);
+    }
+    return times;
+}
+
+// The lockstep kernel has to agree with the scalar solver
+static double getSimdDeviation(const std::vector<float>& hairData, int noOfMasterHairs, int verticesPerStrand,
+                               HairSimdInstructionSet instructionSet, const HairSolverParameters& parameters)
+{
+    std::vector<float> expected(hairData.size()), result(hairData.size());
+    HairSolver check(hairData.data(), noOfMasterHairs, verticesPerStrand);
+    HairSolverSimd simdCheck(hairData.data(), noOfMasterHairs, verticesPerStrand, instructionSet);
+    for(int i = 0; i < 3; i++) {
+        check.simulate(parameters);
+        simdCheck.simulate(parameters);
+    }
+    check.getPositions(expected.data());
+    simdCheck.getPositions(result.data());
+    double maxError = 0.0;
+    for(size_t i = 0; i < expected.size(); i++)
+        maxError = std::fmax(maxError, std::fabs(expected[i] - result[i]));
+    return maxError;
+}
+
+static BenchResult runSolver(const BenchSolver& solver, const std::vector<float>& hairData, int noOfMasterHairs,
+                             int verticesPerStrand, int iterations, int steps, const HairSolverParameters& parameters,
+                             const BenchOptions& options, StrandScheduler& scheduler)
+{
+    BenchResult result;
+    result.solver = &solver;
+    bool threaded = solver.backend == BENCH_SOA_THREADED || solver.backend == BENCH_SIMD_THREADED;
+    result.threads = threaded ? scheduler.getNoOfWorkers() : 1;
+    result.strands = noOfMasterHairs;
+    result.verticesPerStrand = verticesPerStrand;
+    result.iterations = iterations;
+    result.steps = steps;
+    result.maxDeviation = -1.0;
+
+    std::vector<double> times;
+    if(solver.backend == BENCH_REFERENCE) {
+        // rotating the history like main.cpp does
+        const glm::vec4* rest = reinterpret_cast<const glm::vec4*>(hairData.data());
+        std::vector<glm::vec4> previous(rest, rest + (size_t)noOfMasterHairs * verticesPerStrand);
+        std::vector<glm::vec4> current = previous;
+        std::vector<glm::vec4> simulated = previous;
+        times = timeRepetitions(options, steps, [&]() {
+            simulateHairReference(rest, previous.data(), current.data(), simulated.data(),
+                                  noOfMasterHairs, verticesPerStrand, parameters);
+            previous.swap(current);
+            current.swap(simulated);
+        });
+    }
+    else if(solver.backend == BENCH_SOA || solver.backend == BENCH_SOA_THREADED) {
+        HairSolver hairSolver(hairData.data(), noOfMasterHairs, verticesPerStrand);
+        StrandScheduler* workers = threaded ? &scheduler : nullptr;
+        times = timeRepetitions(options, steps, [&]() { hairSolver.simulate(parameters, workers); });
+    }
+    else {
+        HairSolverSimd simdSolver(hairData.data(), noOfMasterHairs, verticesPerStrand, solver.instructionSet);
+        StrandScheduler* workers = threaded ? &scheduler : nullptr;
+        times = timeRepetitions(options, steps, [&]() { simdSolver.simulate(parameters, workers); });
+        if(solver.backend == BENCH_SIMD)
+            result.maxDeviation = getSimdDeviation(hairData, noOfMasterHairs, verticesPerStrand, solver.instructionSet, parameters);
+    }
+
+    result.statistics = getStatistics(times);
+    double seconds = result.statistics.median;
+    double vertices = (double)noOfMasterHairs * verticesPerStrand;
+    int iterationsPerStep = parameters.localShapeIterations +
+        (parameters.lengthConstraintMode == HAIR_LENGTH_ITERATIVE ? parameters.lengthConstraintIterations : 1);
+    result.strandsPerSecond = seconds > 0.0 ? noOfMasterHairs / seconds : 0.0;
+    result.nsPerVertexIteration = seconds * 1e9 / (vertices * iterationsPerStep);
+    result.gigabytesPerSecond = seconds > 0.0 ? vertices * getStateBytesPerVertex(solver) / seconds * 1e-9 : 0.0;
+    return result;
+}
+
+// Positions of a solver after steps steps from the rest pose
+static void simulateSteps(const BenchSolver& solver, const std::vector<float>& hairData, int noOfMasterHairs,
+                          int verticesPerStrand, int steps, const HairSolverParameters& parameters,
+                          StrandScheduler& scheduler, float* positions)
+{
+    bool threaded = solver.backend == BENCH_SOA_THREADED || solver.backend == BENCH_SIMD_THREADED;
+    StrandScheduler* workers = threaded ? &scheduler : nullptr;
+    if(solver.backend == BENCH_REFERENCE) {
+        const glm::vec4* rest = reinterpret_cast<const glm::vec4*>(hairData.data());
+        std::vector<glm::vec4> previous(rest, rest + (size_t)noOfMasterHairs * verticesPerStrand);
+        std::vector<glm::vec4> current = previous;
+        std::vector<glm::vec4> simulated = previous;
+        for(int i = 0; i < steps; i++) {
+            simulateHairReference(rest, previous.data(), current.data(), simulated.data(),
+                                  noOfMasterHairs, verticesPerStrand, parameters);
+            previous.swap(current);
+            current.swap(simulated);
+        }
+        std::copy(&current[0][0], &current[0][0] + 4 * current.size(), positions);
+    }
+    else if(solver.backend == BENCH_SOA || solver.backend == BENCH_SOA_THREADED) {
+        HairSolver hairSolver(hairData.data(), noOfMasterHairs, verticesPerStrand);
+        for(int i = 0; i < steps; i++)
+            hairSolver.simulate(parameters, workers);
+        hairSolver.getPositions(positions);
+    }
+    else {
+        HairSolverSimd simdSolver(hairData.data(), noOfMasterHairs, verticesPerStrand, solver.instructionSet);
+        for(int i = 0; i < steps; i++)
+            simdSolver.simulate(parameters, workers);
+        simdSolver.getPositions(positions);
+    }
+}
+
+// --golden-record and --golden-check, the exit code of the bench
+static int runGolden(const std::vector<BenchSolver>& solvers, const BenchOptions& options, StrandScheduler& scheduler)
+{
+    HairSolverParameters parameters;
+    parameters.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(0.05f, 0.1f, 0.f));
+    parameters.lengthConstraintMode = options.lengthConstraintMode;
+    parameters.localShapeIterations = std::max(options.iterations.front(), 0);
+    parameters.lengthConstraintIterations = std::max(options.iterations.front(), 1);
+
+    if(!options.goldenRecordPath.empty()) {
+        int noOfMasterHairs = options.strands.front();
+        int verticesPerStrand = options.verticesPerStrand.front();
+        std::vector<float> hairData = createHairData(noOfMasterHairs, verticesPerStrand, parameters.hairStrandLength);
+        HairSnapshot snapshot(noOfMasterHairs, verticesPerStrand, parameters.hairStrandLength, options.goldenSteps);
+        simulateSteps(getSolvers().front(), hairData, noOfMasterHairs, verticesPerStrand, options.goldenSteps,
+                      parameters, scheduler, snapshot.getPositions());
+        if(!snapshot.save(options.goldenRecordPath))
+            return 1;
+        printf("Golden snapshot of the reference solver: %d strands, %d vertices, %d steps, written to %s\n",
+               noOfMasterHairs, verticesPerStrand, options.goldenSteps, options.goldenRecordPath.c_str());
+        return 0;
+    }
+
+    HairSnapshot golden;
+    if(!golden.load(options.goldenCheckPath))
+        return 1;
+    int noOfMasterHairs = golden.getNoOfMasterHairs();
+    int verticesPerStrand = golden.getVerticesPerStrand();
+    std::vector<float> hairData = createHairData(noOfMasterHairs, verticesPerStrand, golden.getRestSegmentLength());
+    parameters.hairStrandLength = golden.getRestSegmentLength();
+    printf("Golden snapshot %s: %d strands, %d vertices, %d steps\n", options.goldenCheckPath.c_str(),
+           noOfMasterHairs, verticesPerStrand, golden.getSteps());
+
+    int failed = 0;
+    for(const BenchSolver& solver : solvers) {
+        HairSnapshot result(noOfMasterHairs, verticesPerStrand, golden.getRestSegmentLength(), golden.getSteps());
+        simulateSteps(solver, hairData, noOfMasterHairs, verticesPerStrand, golden.getSteps(), parameters, scheduler,
+                      result.getPositions());
+        HairSnapshotComparison comparison = golden.compare(result, options.goldenTolerances);
+        HairSnapshot::printComparison(std::cout, solver.name, comparison, options.goldenTolerances);
+        if(!comparison.passed)
+            failed++;
+    }
+    if(failed > 0)
+        printf("%d of %d solvers drift from the golden snapshot\n", failed, (int)solvers.size());
+    return failed > 0 ? 1 : 0;
+}
+
+static void printTableHeader()
+{
+    printf("%-14s %3s %8s %5s %5s %6s %14s %10s %10s %8s %8s %10s\n", "solver", "thr", "strands", "verts", "iters",
+           "steps", "strands/s", "ns/v-iter", "GB/s", "median", "cv", "speedup");
+}
+
+static bool hasDeviated(const BenchResult& result, const BenchOptions& options)
+{
+    // written so that NaN fails
+    return result.maxDeviation >= 0.0 && !(result.maxDeviation <= options.maxDeviation);
+}
+
+static void printTableRow(const BenchResult& result, const BenchOptions& options, double baseline)
+{
+    const BenchStatistics& s = result.statistics;
+    double cv = s.mean > 0.0 ? s.stddev / s.mean : 0.0;
+    char speedup[16] = "";
+    if(baseline > 0.0)
+        snprintf(speedup, sizeof(speedup), "%.2fx", baseline / s.median);
+    printf("%-14s %3d %8d %5d %5d %6d %14.0f %10.3f %10.2f %6.2fms %7.1f%% %10s\n", result.solver->name.c_str(),
+           result.threads, result.strands, result.verticesPerStrand, result.iterations, result.steps,
+           result.strandsPerSecond, result.nsPerVertexIteration, result.gigabytesPerSecond, s.median * 1e3,
+           cv * 100.0, speedup);
+    if(hasDeviated(result, options))
+        printf("  FAILED: max deviation from HairSolver is %g (--max-deviation %g)\n", result.maxDeviation,
+               options.maxDeviation);
+}
+
+static void printCsvHeader()
+{
+    printf("solver,threads,strands,vertices_per_strand,iterations,steps,repetitions,min_s,median_s,mean_s,stddev_s,"
+           "strands_per_s,ns_per_vertex_iteration,gb_per_s,max_deviation\n");
+}
+
+static void printCsvRow(const BenchResult& result, const BenchOptions& options)
+{
+    const BenchStatistics& s = result.statistics;
+    printf("%s,%d,%d,%d,%d,%d,%d,%.9g,%.9g,%.9g,%.9g,%.6g,%.6g,%.6g,%.6g\n", result.solver->name.c_str(),
+           result.threads, result.strands, result.verticesPerStrand, result.iterations, result.steps,
+           options.repetitions, s.min, s.median, s.mean, s.stddev, result.strandsPerSecond,
+           result.nsPerVertexIteration, result.gigabytesPerSecond, result.maxDeviation);
+}
+
+static void printJson(const std::vector<BenchResult>& results, const BenchOptions& options, int workers)
+{
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    printf("{\n  \"timestamp\": \"%s\",\n  \"hardwareThreads\": %u,\n  \"workers\": %d,\n"
+           "  \"bestInstructionSet\": \"%s\",\n  \"lengthConstraintMode\": \"%s\",\n"
+           "  \"warmupSteps\": %d,\n  \"repetitions\": %d,\n  \"maxDeviationTolerance\": %.6g,\n  \"results\": [\n",
+           timestamp, std::thread::hardware_concurrency(), workers,
+           HairSolverSimd::getName(HairSolverSimd::getBestInstructionSet()),
+           options.lengthConstraintMode == HAIR_LENGTH_FTL ? "ftl" : "iterative",
+           options.warmupSteps, options.repetitions, options.maxDeviation);
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        const BenchStatistics& s = result.statistics;
+        printf("    {\"solver\": \"%s\", \"threads\": %d, \"strands\": %d, \"verticesPerStrand\": %d, \"iterations\": %d, "
+               "\"steps\": %d, \"minS\": %.9g, \"medianS\": %.9g, \"meanS\": %.9g, \"stddevS\": %.9g, "
+               "\"strandsPerS\": %.6g, \"nsPerVertexIteration\": %.6g, \"gbPerS\": %.6g, \"maxDeviation\": %.6g}%s\n",
+               result.solver->name.c_str(), result.threads, result.strands, result.verticesPerStrand,
+               result.iterations, result.steps, s.min, s.median, s.mean, s.stddev, result.strandsPerSecond,
+               result.nsPerVertexIteration, result.gigabytesPerSecond, result.maxDeviation,
+               i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+// Comma separated values of an option
+static std::vector<std::string> splitList(const char* text)
+{
+    std::vector<std::string> values;
+    std::string list = text;
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = std::min(list.find(',', start), list.size());
+        if(end > start)
+            values.push_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return values;
+}
+
+static std::vector<int> parseList(const char* text)
+{
+    std::vector<int> values;
+    for(const std::string& value : splitList(text))
+        values.push_back(atoi(value.c_str()));
+    return values;
+}
+
+static void printUsage(const char* program)
+{
+    printf("usage: %s [options]\n"
+           "  --strands <n,...>         strand counts (1000,10000,100000,1000000)\n"
+           "  --vertices <n,...>        vertices per strand, 2 to %d (8,16,32,64)\n"
+           "  --iterations <n,...>      local shape and length constraint iterations (5)\n"
+           "  --solvers <name,...>      subset of:",
+           program, HairSolver::maxVerticesPerStrand);
+    for(const BenchSolver& solver : getSolvers())
+        printf(" %s", solver.name.c_str());
+    printf("\n"
+           "  --ftl                     follow-the-leader length constraint instead of iterations\n"
+           "  --warmup <steps>          untimed steps before the repetitions (2)\n"
+           "  --repetitions <n>         timed repetitions (5)\n"
+           "  --steps <n>               steps per repetition, default sized to 2^24 vertex steps\n"
+           "  --threads <n>             workers of soa-mt and simd-mt, 0 for all hardware threads (0)\n"
+           "  --max-memory <MB>         skips larger configurations (2048)\n"
+           "  --format <table|csv|json> output format (table)\n"
+           "  --max-deviation <dist>    largest deviation of a SIMD backend from HairSolver after\n"
+           "                            3 steps, exits with 1 beyond it (1e-5)\n"
+           "  --golden-record <file>    stores the reference solver after --golden-steps steps (60)\n"
+           "                            of the first strand count, vertex count and iteration count\n"
+           "  --golden-check <file>     compares the solvers with the snapshot, exits with 1 on drift\n"
+           "  --golden-max <distance>   largest vertex deviation (1e-3)\n"
+           "  --golden-rms <distance>   root mean square vertex deviation (1e-4)\n"
+           "  --golden-segment <share>  largest segment length change over the rest length (1e-2)\n");
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for(int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(argument == "--strands" && hasValue)
+            options.strands = parseList(argv[++i]);
+        else if(argument == "--vertices" && hasValue)
+            options.verticesPerStrand = parseList(argv[++i]);
+        else if(argument == "--iterations" && hasValue)
+            options.iterations = parseList(argv[++i]);
+        else if(argument == "--solvers" && hasValue)
+            options.solvers = splitList(argv[++i]);
+        else if(argument == "--ftl")
+            options.lengthConstraintMode = HAIR_LENGTH_FTL;
+        else if(argument == "--warmup" && hasValue)
+            options.warmupSteps = std::max(atoi(argv[++i]), 0);
+        else if(argument == "--repetitions" && hasValue)
+            options.repetitions = std::max(atoi(argv[++i]), 1);
+        else if(argument == "--steps" && hasValue)
+            options.steps = std::max(atoi(argv[++i]), 0);
+        else if(argument == "--threads" && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if(argument == "--max-memory" && hasValue)
+            options.maxMemoryMb = atof(argv[++i]);
+        else if(argument == "--format" && hasValue)
+            options.format = argv[++i];
+        else if(argument == "--max-deviation" && hasValue)
+            options.maxDeviation = atof(argv[++i]);
+        else if(argument == "--golden-record" && hasValue)
+            options.goldenRecordPath = argv[++i];
+        else if(argument == "--golden-check" && hasValue)
+            options.goldenCheckPath = argv[++i];
+        else if(argument == "--golden-steps" && hasValue)
+            options.goldenSteps = std::max(atoi(argv[++i]), 1);
+        else if(argument == "--golden-max" && hasValue)
+            options.goldenTolerances.maxDeviation = atof(argv[++i]);
+        else if(argument == "--golden-rms" && hasValue)
+            options.goldenTolerances.rmsDeviation = atof(argv[++i]);
+        else if(argument == "--golden-segment" && hasValue)
+            options.goldenTolerances.segmentLengthError = atof(argv[++i]);
+        else {
+            printUsage(argv[0]);
+            return argument == "--help" ? 0 : 1;
+        }
+    }
+    if(options.format != "table" && options.format != "csv" && options.format != "json") {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<BenchSolver> allSolvers = getSolvers();
+    std::vector<BenchSolver> solvers;
+    for(const BenchSolver& solver : allSolvers)
+        if(options.solvers.empty() || std::find(options.solvers.begin(), options.solvers.end(), solver.name) != options.solvers.end())
+            solvers.push_back(solver);
+    if(solvers.empty()) {
+        printf("No solver matches --solvers\n");
+        return 1;
+    }
+
+    StrandScheduler scheduler(options.threads);
+    if(!options.goldenRecordPath.empty() || !options.goldenCheckPath.empty()) {
+        if(options.strands.empty() || options.verticesPerStrand.empty() || options.iterations.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runGolden(solvers, options, scheduler);
+    }
+
+    bool table = options.format == "table";
+    if(table)
+        printf("%d warm-up steps, %d repetitions, %d worker threads, %s length constraints\n", options.warmupSteps,
+               options.repetitions, scheduler.getNoOfWorkers(),
+               options.lengthConstraintMode == HAIR_LENGTH_FTL ? "follow-the-leader" : "iterative");
+    else if(options.format == "csv")
+        printCsvHeader();
+
+    std::vector<BenchResult> results;
+    bool deviated = false;
+    for(int verticesPerStrand : options.verticesPerStrand) {
+        if(verticesPerStrand < 2 || verticesPerStrand > HairSolver::maxVerticesPerStrand) {
+            fprintf(stderr, "Skipping %d vertices per strand, supported are 2 to %d\n", verticesPerStrand,
+                    HairSolver::maxVerticesPerStrand);
+            continue;
+        }
+        for(int noOfMasterHairs : options.strands) {
+            if(noOfMasterHairs <= 0)
+                continue;
+            double vertices = (double)noOfMasterHairs * verticesPerStrand;
+            int steps = options.steps > 0 ? options.steps :
+                std::max(1, std::min(1000, (int)(options.vertexStepsPerRepetition / vertices)));
+
+            HairSolverParameters parameters;
+            parameters.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(0.05f, 0.1f, 0.f));
+            parameters.lengthConstraintMode = options.lengthConstraintMode;
+            std::vector<float> hairData;
+
+            for(int iterations : options.iterations) {
+                parameters.localShapeIterations = std::max(iterations, 0);
+                parameters.lengthConstraintIterations = std::max(iterations, 1);
+                if(table) {
+                    printf("\n");
+                    printTableHeader();
+                }
+                double baseline = 0.0;
+                for(const BenchSolver& solver : solvers) {
+                    // the groom, the solver state and the check of the SIMD backends
+                    double megabytes = vertices * (4 * sizeof(float) + getStateBytesPerVertex(solver) +
+                        (solver.backend == BENCH_SIMD ? 8 * 3 * sizeof(float) : 0)) / (1024.0 * 1024.0);
+                    if(megabytes > options.maxMemoryMb) {
+                        fprintf(stderr, "Skipping %s with %d strands of %d vertices, needs %.0f MB (--max-memory %.0f)\n",
+                                solver.name.c_str(), noOfMasterHairs, verticesPerStrand, megabytes, options.maxMemoryMb);
+                        continue;
+                    }
+                    if(hairData.empty())
+                        hairData = createHairData(noOfMasterHairs, verticesPerStrand, parameters.hairStrandLength);
+
+                    BenchResult result = runSolver(solver, hairData, noOfMasterHairs, verticesPerStrand, iterations,
+                                                   steps, parameters, options, scheduler);
+                    // speedups against the first solver of the configuration, the reference by default
+                    if(baseline == 0.0)
+                        baseline = result.statistics.median;
+                    if(hasDeviated(result, options))
+                        deviated = true;
+                    if(table)
+                        printTableRow(result, options, baseline);
+                    else if(options.format == "csv") {
+                        printCsvRow(result, options);
+                        fflush(stdout);
+                    }
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    if(options.format == "json")
+        printJson(results, options, scheduler.getNoOfWorkers());
+    else if(table) {
+        printf("\n");
+        scheduler.printUtilisation(std::cout);
+    }
+    if(deviated) {
+        fprintf(stderr, "A SIMD backend deviates from HairSolver by more than %g\n", options.maxDeviation);
+        return 1;
+    }
+    return 0;
+}
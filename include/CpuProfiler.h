@@ -0,0 +1,85 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones written to a Chrome trace (chrome://tracing, Perfetto).
+//
+// A zone is an RAII marker, CPU_PROFILE_ZONE("name"), timing the rest of its
+// scope. Every thread writes its finished zones into its own ring buffer with
+// no locks; flush() moves them from all rings into the trace file. A zone that
+// finds its ring full is dropped and counted. Zone names must be string
+// literals, a detail (a file name) is copied into the zone.
+//
+// While no trace is running a zone costs one relaxed atomic load.
+// HAIR_NO_CPU_PROFILER compiles the zones out.
+//
+// Times are nanoseconds of std::chrono::steady_clock. GPU times, shifted onto
+// that clock by the caller, go into the trace with addGpuZone() on their own row.
+class CpuProfiler
+{
+public:
+    static const int ringSize = 1 << 14; // zones per thread between two flushes
+
+    static bool isEnabled(){
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t now();
+
+    // Name of the calling thread in the trace
+    static void setThreadName(const char* name);
+
+    // A finished zone of the calling thread
+    static void record(const char* name, const char* detail, uint64_t begin, uint64_t end);
+
+    // Starts writing the trace to path and enables the zones
+    static bool startTrace(const std::string& path);
+
+    // flush(), addGpuZone() and stopTrace() write the file and are called from the
+    // thread that started the trace
+    static void flush();
+    static void addGpuZone(const std::string& name, uint64_t begin, uint64_t end);
+    static void stopTrace();
+
+    static long getDroppedZones();
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+class CpuZone
+{
+public:
+    explicit CpuZone(const char* name, const char* detail = nullptr)
+        : name(CpuProfiler::isEnabled() ? name : nullptr), detail(detail), begin(this->name ? CpuProfiler::now() : 0)
+    {
+    }
+
+    ~CpuZone(){
+        if(name)
+            CpuProfiler::record(name, detail, begin, CpuProfiler::now());
+    }
+
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name;
+    const char* detail;
+    uint64_t begin;
+};
+
+#define CPU_PROFILE_CONCAT_(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_(a, b)
+#ifdef HAIR_NO_CPU_PROFILER
+#define CPU_PROFILE_ZONE(name)
+#define CPU_PROFILE_ZONE_DETAIL(name, detail)
+#else
+#define CPU_PROFILE_ZONE(name) CpuZone CPU_PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#define CPU_PROFILE_ZONE_DETAIL(name, detail) CpuZone CPU_PROFILE_CONCAT(cpuZone, __LINE__)(name, detail)
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// GPU time per stage of a frame, measured with GL_TIMESTAMP queries.
+//
+// Every begin() and end() puts a timestamp query into the command stream. A stage
+// may run several times in a frame (once per simulation substep); its time in the
+// frame is the sum over its runs. The queries of a frame are read back
+// framesInFlight frames later and only if the GPU has finished them, so profiling
+// never waits for the GPU; frames that are still not finished then are dropped.
+//
+// The last windowSize frame times of each stage are kept for the rolling
+// statistics. Times are in milliseconds.
+class GpuProfiler
+{
+public:
+    static const int framesInFlight = 4;
+    static const int windowSize = 256;
+
+    struct Statistics
+    {
+        int samples = 0; // frames in the window the stage ran in
+        double last = 0.0;
+        double min = 0.0;
+        double mean = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Registers a stage and returns its index for begin() and end()
+    int addStage(const std::string& name);
+
+    int getNoOfStages() const{
+        return (int)stages.size();
+    }
+
+    const std::string& getStageName(int stage) const{
+        return stages[stage].name;
+    }
+
+    // Collects the results of the oldest frame in flight and starts recording a new one
+    void beginFrame();
+
+    // Timestamps around a stage. Stages may follow each other or nest, but a stage
+    // is not begun again before it ended.
+    void begin(int stage);
+    void end(int stage);
+
+    void endFrame();
+
+    Statistics getStatistics(int stage) const;
+
+    // Frames measured and frames dropped because their queries were not finished in time
+    int getMeasuredFrames() const{
+        return measuredFrames;
+    }
+
+    int getDroppedFrames() const{
+        return droppedFrames;
+    }
+
+    // Called for every run of a stage when its frame is read back, with the
+    // GL_TIMESTAMP values of its begin and end in nanoseconds
+    void setRunCallback(const std::function<void(int, GLuint64, GLuint64)>& callback){
+        runCallback = callback;
+    }
+
+    // The statistics of every stage as a table for the console
+    void print(std::ostream& out) const;
+
+    // Appends one CSV row per stage: frame,stage,samples,last,min,mean,p95,p99.
+    // header writes the column names first.
+    void writeCsv(std::ostream& out, bool header) const;
+
+    // The statistics of every stage as one JSON object
+    void writeJson(std::ostream& out) const;
+
+private:
+    struct Stage
+    {
+        std::string name;
+        std::vector<double> window; // ring of frame times
+        int next = 0;               // slot of the next frame time in window
+        int open = -1;              // query pair of the running begin(), -1 if none
+    };
+
+    // Queries of one frame: pairs of begin and end timestamps and their stages
+    struct Frame
+    {
+        std::vector<GLuint> queries;
+        std::vector<int> pairStages;
+        int noOfPairs = 0;
+        GLuint lastQuery = 0;
+        bool pending = false;
+    };
+
+    void collect(Frame& frame);
+
+    std::vector<Stage> stages;
+    std::function<void(int, GLuint64, GLuint64)> runCallback;
+    Frame frames[framesInFlight];
+    int currentFrame;
+    int frameNumber;
+    int measuredFrames;
+    int droppedFrames;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef HAIR_ACTIVITY_H
+#define HAIR_ACTIVITY_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "HairSolver.h"
+
+// Sleeping strands. The simulation kernels store the kinetic energy of every strand
+// they simulate; before each dispatch HairActivity.comp counts how many steps in a
+// row a strand stayed below the sleep threshold and appends the strands that are
+// still awake to a compacted list. The simulation is then dispatched indirectly over
+// that list, so settled strands cost nothing.
+//
+// A strand wakes up when its root has moved away from its rest position (the head
+// moved), when the forces changed, see forcesChanged(), or when the wind at its
+// root changed by enough to lift it over the sleep threshold within a step, and
+// stays awake while a force field that is not drag reaches it (HairForceFields.h).
+// A sleeping strand leaves all state slots untouched; it only falls asleep after at
+// least minSleepSteps calm steps, so every slot of HairStateBuffers holds its
+// settled positions by then.
+//
+// The classification also schedules the temporal level of detail: distant and
+// off-screen strands get an update interval of 2 or 4 and only step in every
+// second or fourth dispatch. In the others they are listed as skipped and
+// HairExtrapolation.comp moves them on inertially, so their history stays one step
+// apart like that of every other strand.
+//
+// GPU buffers, bound to the SSBO bindings following the hair state:
+//  5 strand activity: kinetic energy, calm steps, update interval and settled
+//    wind per strand
+//  6 active strands: indices of the strands to simulate
+//  7 dispatch commands: indirect commands of the single and the cooperative kernel
+//    and of the extrapolation, followed by the skipped strand count. The active
+//    strand count is the y group count of the single kernel.
+// 10 skipped strands: indices of the strands to extrapolate
+class HairActivity
+{
+public:
+    static const int minSleepSteps = 6;            // HairStateBuffers slots with one frame of render latency
+    static const int classificationGroupSize = 64; // local_size_x of HairActivity.comp
+    static const int extrapolationGroupSize = 64;  // local_size_x of HairExtrapolation.comp
+
+    explicit HairActivity(int noOfMasterHairs);
+    ~HairActivity();
+
+    HairActivity(const HairActivity&) = delete;
+    HairActivity& operator=(const HairActivity&) = delete;
+
+    // Whether the kernel inputs that act on resting strands differ from those of the
+    // last call. True on the first call, all strands are awake then anyway.
+    bool forcesChanged(const HairSolverParameters& parameters);
+
+    // Resets the dispatch commands and binds the activity buffers to SSBO bindings 5-7 and 10
+    void bindForClassification();
+
+    // One invocation of HairActivity.comp per strand
+    void dispatchClassification() const;
+
+    // Dispatches the bound simulation kernel over the active strands
+    void dispatchSimulation(bool cooperativeKernel) const;
+
+    // Dispatches the bound HairExtrapolation.comp over the skipped strands
+    void dispatchExtrapolation() const;
+
+    // Reads back the number of active strands of the last classification; stalls
+    // until the GPU got there, so only for occasional statistics
+    int readActiveStrandCount() const;
+
+private:
+    int noOfMasterHairs;
+    GLuint activityBuffer;
+    GLuint activeStrandBuffer;
+    GLuint skippedStrandBuffer;
+    GLuint dispatchBuffer;
+
+    bool hasForces;
+    HairSolverParameters forces; // kernel inputs of the last forcesChanged() call
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef HAIR_ASSETS_H
+#define HAIR_ASSETS_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include <vector>
+
+#include "HairSolver.h"
+
+// std430 element of the asset parameter buffer, mirrored in the shaders that read it
+struct HairAssetParameters
+{
+    glm::mat4 modelMatrix = glm::mat4(1.f);
+    glm::mat4 inverseModelMatrix = glm::mat4(1.f); // kept up to date by HairAssets
+    GLfloat damping = 0.f;
+    GLfloat hairStrandLength = 0.005f;
+    GLfloat globalStiffness = 0.8f; // at the root, falls off linearly towards the tip
+    GLfloat localStiffness = 0.005f;
+    GLfloat windResponse = 1.f;     // scales the wind force
+    GLint firstStrand = 0;          // set by HairAssets::add()
+    GLint noOfStrands = 0;
+    GLint lengthConstraintMode = HAIR_LENGTH_ITERATIVE; // HairLengthConstraintMode
+    GLfloat ftlDamping = 0.9f;      // HAIR_LENGTH_FTL only, see HairSolverParameters
+    GLfloat padding[3] = {0.f, 0.f, 0.f};
+};
+
+// Many hair assets (characters of a crowd) simulated by the same dispatches.
+//
+// The strands of all assets are packed one asset after the other into one
+// HairStateBuffers, all with the verticesPerStrand the kernels are compiled for.
+// Everything that used to be a per-object uniform (model matrix, damping, segment
+// length, stiffness, wind response, length constraint) is a row of the asset parameter table, and a
+// strand to asset table lets every kernel invocation find the row of its strand.
+// The number of dispatches and uniform updates per step therefore does not depend
+// on the number of assets; a frame uploads the table once if it changed.
+//
+// GPU buffers, bound to the SSBO bindings following HairForceFields:
+// 13 asset parameters: one HairAssetParameters per asset
+// 14 strand assets: asset index per packed strand
+class HairAssets
+{
+public:
+    HairAssets();
+    ~HairAssets();
+
+    HairAssets(const HairAssets&) = delete;
+    HairAssets& operator=(const HairAssets&) = delete;
+
+    // Appends an asset of noOfStrands strands behind the ones added before and
+    // returns its index; firstStrand and noOfStrands of parameters are filled in
+    int add(int noOfStrands, const HairAssetParameters& parameters);
+
+    const HairAssetParameters& getParameters(int asset) const{
+        return parameters[asset];
+    }
+
+    // For changes, the table is uploaded again at the next bind()
+    HairAssetParameters& getParameters(int asset){
+        parametersDirty = true;
+        return parameters[asset];
+    }
+
+    int getNoOfAssets() const{
+        return (int)parameters.size();
+    }
+
+    // Strands of all assets
+    int getNoOfStrands() const{
+        return (int)strandAssets.size();
+    }
+
+    int getAsset(int strand) const{
+        return (int)strandAssets[strand];
+    }
+
+    // Uploads what changed and binds the tables to SSBO bindings 13 and 14
+    void bind();
+
+private:
+    std::vector<HairAssetParameters> parameters;
+    std::vector<GLuint> strandAssets;
+    GLuint parameterBuffer;
+    GLuint strandAssetBuffer;
+    bool parametersDirty;
+    bool strandsDirty;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef HAIR_FORCE_FIELDS_H
+#define HAIR_FORCE_FIELDS_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include <vector>
+
+// Kinds of force fields, the type field of HairForceField
+enum HairForceFieldType {
+    HAIR_FIELD_POINT,       // pushes away from the center, pulls towards it with negative strength (explosions)
+    HAIR_FIELD_DIRECTIONAL, // pushes along direction (fans)
+    HAIR_FIELD_VORTEX,      // pushes around the axis direction through the center
+    HAIR_FIELD_TURBULENCE,  // smooth pseudo random acceleration that changes over time
+    HAIR_FIELD_DRAG         // slows vertices down, strength per second
+};
+
+// std430 element of the force field buffer, mirrored in the simulation kernels.
+// Strengths are accelerations. A field with a radius acts inside the sphere of that
+// radius around its center and is scaled by (1 - distance / radius)^falloff; a
+// radius of 0 makes it act everywhere.
+struct HairForceField
+{
+    glm::vec4 center = glm::vec4(0.f);    // xyz world space center, w radius
+    glm::vec4 direction = glm::vec4(0.f); // xyz direction or axis, w strength
+    GLint type = HAIR_FIELD_DIRECTIONAL;
+    GLfloat falloff = 1.f;
+    GLfloat frequency = 1.f; // turbulence: pattern cells per world unit
+    GLfloat padding = 0.f;
+};
+
+// Local effectors (fans, explosions, character motion) on top of the wind field.
+//
+// The fields live in one shader storage buffer. Before the integration each
+// workgroup of the simulation kernels lists the fields whose sphere reaches one
+// of its strands (root plus strand length) and its vertices only evaluate those,
+// so dozens of local fields cost little where they do not act. The classification
+// keeps strands in reach of a field that adds energy awake.
+//
+// GPU buffers, bound to the SSBO binding following HairVolume:
+// 12 force fields
+class HairForceFields
+{
+public:
+    // Capacity of the per workgroup lists in the kernels (maxFieldsPerGroup); of
+    // more fields that reach the same workgroup only the ones with the lowest
+    // indices act there
+    static const int maxFieldsPerGroup = 16;
+
+    HairForceFields();
+    ~HairForceFields();
+
+    HairForceFields(const HairForceFields&) = delete;
+    HairForceFields& operator=(const HairForceFields&) = delete;
+
+    // Returns the index of the new field
+    int add(const HairForceField& field);
+
+    HairForceField& getField(int index){
+        dirty = true;
+        return fields[index];
+    }
+
+    int getNoOfFields() const{
+        return (int)fields.size();
+    }
+
+    void clear();
+
+    // Uploads the fields if they changed and binds them to SSBO binding 12. Warns
+    // once when more than maxFieldsPerGroup fields can reach the same strand, for
+    // strands that reach strandReach beyond their root.
+    void bind(float strandReach);
+
+    // Largest number of fields that can reach one strand: a field and all fields
+    // whose spheres, grown by strandReach, intersect its own. Fields without a
+    // radius reach every strand.
+    int getMaxOverlappingFields(float strandReach) const;
+
+    static HairForceField point(const glm::vec3& center, float radius, float strength, float falloff = 1.f);
+    static HairForceField directional(const glm::vec3& center, float radius, const glm::vec3& direction, float strength, float falloff = 1.f);
+    static HairForceField vortex(const glm::vec3& center, float radius, const glm::vec3& axis, float strength, float falloff = 1.f);
+    static HairForceField turbulence(const glm::vec3& center, float radius, float strength, float frequency, float falloff = 1.f);
+    static HairForceField drag(const glm::vec3& center, float radius, float strength, float falloff = 1.f);
+
+private:
+    std::vector<HairForceField> fields;
+    GLuint fieldBuffer;
+    size_t bufferCapacity; // fields the buffer has room for
+    bool dirty;
+    bool overlapWarned;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef HAIR_LOD_H
+#define HAIR_LOD_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "shader_c.h"
+#include "HairAssets.h"
+
+#include <vector>
+
+// Simulation level of detail for the guide (master) strands.
+//
+// The strands are ranked by importance with farthest point sampling over their
+// roots, so any prefix of the ranking covers the emitter evenly. The ranking is cut
+// into levels that double in size: level 0 holds the first guidesInFirstLevel
+// strands and is always simulated, level l > 0 the ranks [start(l), 2 * start(l)).
+// Every strand of a level l > 0 is interpolated from its three nearest strands of
+// the coarser levels, which carry its displacement from the rest pose.
+//
+// With several hair assets (HairAssets.h) every asset is ranked on its own and the
+// rankings are merged in proportion to the asset sizes, after the first three
+// strands of every asset, so every level covers all assets evenly and strands only
+// take parents from their own asset. The level is shared by all assets.
+//
+// update() picks a level from the projected size of the hair: all levels below
+// getLevel() are simulated, the level getLevel() is cut into is simulated as well
+// but blended in by the fractional part, and everything above it is interpolated.
+// The level follows the projected size at a limited rate, so the simulated set
+// grows and shrinks one blended level at a time.
+//
+// GPU buffers, bound to the SSBO bindings following HairActivity:
+//  8 guides: parents, rank and weights per strand
+//  9 ranking: the strand of every rank
+class HairLod
+{
+public:
+    static const int interpolationGroupSize = 64; // local_size_x of HairLodInterpolation.comp
+
+    // hairData is laid out the way createMasterHairs() produces it, in object space,
+    // with the strands of the assets packed
+    HairLod(const GLfloat* hairData, const HairAssets& assets, int verticesPerStrand, int guidesInFirstLevel = 64);
+    ~HairLod();
+
+    HairLod(const HairLod&) = delete;
+    HairLod& operator=(const HairLod&) = delete;
+
+    // Moves the level towards the one that simulates about one guide per
+    // pixelsPerGuide pixels of the projected hair bounding spheres of all assets
+    void update(const HairAssets& assets, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                float pixelsPerGuide, float fadeLevelsPerSecond, float deltaTime);
+
+    // Simulates every strand from now on, without blending
+    void simulateAll();
+
+    // Strands ranked below this are simulated
+    int getSimulatedStrands() const;
+
+    // Strands ranked in [getFadingRank(), getSimulatedStrands()) are being blended in or out
+    int getFadingRank() const;
+
+    // Number of fully simulated levels plus the blend of the next one, in [1, getNoOfLevels()]
+    float getLevel() const{
+        return level;
+    }
+
+    int getNoOfLevels() const{
+        return (int)levelStarts.size() - 1;
+    }
+
+    // Binds the guide and ranking buffers to SSBO bindings 8 and 9
+    void bindBuffers() const;
+
+    // Interpolates all strands that are not fully simulated, coarse levels first.
+    // Call after the simulation dispatch, with the simulation state still bound.
+    void dispatchInterpolation(ComputeShader& interpolationShader) const;
+
+private:
+    // std430 element of the guide buffer
+    struct Guide
+    {
+        GLint parents[3];
+        GLint rank;
+        GLfloat weights[4];
+    };
+
+    // Farthest point ranking of the given strands
+    void rankStrands(const std::vector<glm::vec3>& roots, const std::vector<int>& strands, std::vector<int>& ranking) const;
+    float getLevelForGuides(float guides) const;
+
+    int noOfMasterHairs;
+    std::vector<int> levelStarts; // first rank of each level, followed by noOfMasterHairs
+    std::vector<glm::vec3> boundingCenters; // object space bounding sphere of the rest pose per asset
+    std::vector<float> boundingRadii;
+    float level;
+    GLuint guideBuffer;
+    GLuint rankingBuffer;
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef HAIR_SIMD_KERNEL_H
+#define HAIR_SIMD_KERNEL_H
+
+#include "HairSolverSimd.h"
+
+// Strand-lockstep version of HairSolver::simulateStrands(). It is included by the
+// instruction set specific translation units and instantiated with their lane type,
+// which has to provide:
+//   static const int lanes;
+//   static Lanes load(const float* p);  void store(float* p) const;
+//   static Lanes set(float value);
+//   operator+, operator-, operator*, operator/ and sqrt(Lanes)
+// Every operation in the loops below works on whole registers, there is no
+// per-lane code in the kernel. The lane type is declared in an anonymous namespace,
+// which gives the instantiation internal linkage, and the kernel calls nothing but
+// its members (see HairSimdStep).
+template <class Lanes>
+void simulateHairBlocks(const HairSimdBlocks& blocks, int firstBlock, int lastBlock,
+                        const HairSimdStep& step)
+{
+    const int L = Lanes::lanes;
+    const int n = blocks.verticesPerStrand;
+
+    // Constants of the constraint stages, same values as in HairSimulation.comp
+    const float maxStiffness = 0.8f;
+    const float localStiffness = 0.005f;
+
+    const float (*m)[3] = step.modelMatrix;
+    const Lanes m00 = Lanes::set(m[0][0]), m01 = Lanes::set(m[0][1]), m02 = Lanes::set(m[0][2]);
+    const Lanes m10 = Lanes::set(m[1][0]), m11 = Lanes::set(m[1][1]), m12 = Lanes::set(m[1][2]);
+    const Lanes m20 = Lanes::set(m[2][0]), m21 = Lanes::set(m[2][1]), m22 = Lanes::set(m[2][2]);
+    const Lanes m30 = Lanes::set(m[3][0]), m31 = Lanes::set(m[3][1]), m32 = Lanes::set(m[3][2]);
+
+    const Lanes timeStep2 = Lanes::set(step.timeStep2);
+    const Lanes velocityScale = Lanes::set(step.velocityScale);
+    const Lanes strandLength = Lanes::set(step.hairStrandLength);
+    const Lanes gravityY = Lanes::set(-9.8f);
+    const Lanes localCorrection = Lanes::set(0.5f * localStiffness);
+    const Lanes half = Lanes::set(0.5f);
+    const Lanes ftlDamping = Lanes::set(step.ftlDamping);
+    const Lanes ftlEpsilon = Lanes::set(hairFtlEpsilon);
+    const Lanes windX = Lanes::set(step.wind[0]), windY = Lanes::set(step.wind[1]), windZ = Lanes::set(step.wind[2]);
+
+    Lanes restX[HairSolver::maxVerticesPerStrand], restY[HairSolver::maxVerticesPerStrand], restZ[HairSolver::maxVerticesPerStrand];
+    Lanes newX[HairSolver::maxVerticesPerStrand], newY[HairSolver::maxVerticesPerStrand], newZ[HairSolver::maxVerticesPerStrand];
+
+    for(int block = firstBlock; block < lastBlock; block++) {
+        const int base = block * n * L;
+
+        //Initialization
+        for(int i = 0; i < n; i++) {
+            const int offset = base + i * L;
+            Lanes x = Lanes::load(blocks.rest[0] + offset);
+            Lanes y = Lanes::load(blocks.rest[1] + offset);
+            Lanes z = Lanes::load(blocks.rest[2] + offset);
+            restX[i] = m00 * x + m10 * y + m20 * z + m30;
+            restY[i] = m01 * x + m11 * y + m21 * z + m31;
+            restZ[i] = m02 * x + m12 * y + m22 * z + m32;
+            newX[i] = Lanes::load(blocks.current[0] + offset);
+            newY[i] = Lanes::load(blocks.current[1] + offset);
+            newZ[i] = Lanes::load(blocks.current[2] + offset);
+        }
+
+        //Integration
+        for(int i = 1; i < n; i++) {
+            const int offset = base + i * L;
+            Lanes oldX = Lanes::load(blocks.previous[0] + offset);
+            Lanes oldY = Lanes::load(blocks.previous[1] + offset);
+            Lanes oldZ = Lanes::load(blocks.previous[2] + offset);
+            Lanes currX = newX[i], currY = newY[i], currZ = newZ[i];
+
+            // velocity = newPos[i-1] - newPos[i]
+            Lanes vX = newX[i-1] - currX, vY = newY[i-1] - currY, vZ = newZ[i-1] - currZ;
+            // force = gravity + cross(cross(velocity, wind), velocity)
+            Lanes cX = vY * windZ - vZ * windY;
+            Lanes cY = vZ * windX - vX * windZ;
+            Lanes cZ = vX * windY - vY * windX;
+            Lanes fX = cY * vZ - cZ * vY;
+            Lanes fY = cZ * vX - cX * vZ + gravityY;
+            Lanes fZ = cX * vY - cY * vX;
+
+            newX[i] = currX + velocityScale * (currX - oldX) + fX * timeStep2;
+            newY[i] = currY + velocityScale * (currY - oldY) + fY * timeStep2;
+            newZ[i] = currZ + velocityScale * (currZ - oldZ) + fZ * timeStep2;
+        }
+
+        //Global shape constraints
+        float stiffness = maxStiffness;
+        for(int i = 0; i < n; i++) {
+            Lanes s = Lanes::set(stiffness);
+            newX[i] = newX[i] + s * (restX[i] - newX[i]);
+            newY[i] = newY[i] + s * (restY[i] - newY[i]);
+            newZ[i] = newZ[i] + s * (restZ[i] - newZ[i]);
+            stiffness -= maxStiffness / n;
+        }
+
+        //Local shape constraints
+        for(int k = 0; k < step.localShapeIterations; k++) {
+            for(int i = 1; i < n; i++) {
+                Lanes dX = localCorrection * (restX[i] - newX[i]);
+                Lanes dY = localCorrection * (restY[i] - newY[i]);
+                Lanes dZ = localCorrection * (restZ[i] - newZ[i]);
+                newX[i-1] = newX[i-1] - dX;
+                newY[i-1] = newY[i-1] - dY;
+                newZ[i-1] = newZ[i-1] - dZ;
+                newX[i] = newX[i] + dX;
+                newY[i] = newY[i] + dY;
+                newZ[i] = newZ[i] + dZ;
+            }
+        }
+
+        //Length constraints
+        if(step.lengthConstraintMode == HAIR_LENGTH_FTL) {
+            for(int i = 1; i < n; i++) {
+                const int offset = base + (i-1) * L;
+                Lanes dX = newX[i] - newX[i-1];
+                Lanes dY = newY[i] - newY[i-1];
+                Lanes dZ = newZ[i] - newZ[i-1];
+                Lanes scale = strandLength / sqrt(dX * dX + dY * dY + dZ * dZ + ftlEpsilon);
+                Lanes x = newX[i-1] + scale * dX;
+                Lanes y = newY[i-1] + scale * dY;
+                Lanes z = newZ[i-1] + scale * dZ;
+                // velocity correction of the previous vertex, through the current positions
+                (Lanes::load(blocks.current[0] + offset) + ftlDamping * (x - newX[i])).store(blocks.current[0] + offset);
+                (Lanes::load(blocks.current[1] + offset) + ftlDamping * (y - newY[i])).store(blocks.current[1] + offset);
+                (Lanes::load(blocks.current[2] + offset) + ftlDamping * (z - newZ[i])).store(blocks.current[2] + offset);
+                newX[i] = x;
+                newY[i] = y;
+                newZ[i] = z;
+            }
+        }
+        else {
+            for(int k = 0; k < step.lengthConstraintIterations; k++) {
+                for(int i = 0; i < n-1; i++) {
+                    Lanes dX = newX[i] - newX[i+1];
+                    Lanes dY = newY[i] - newY[i+1];
+                    Lanes dZ = newZ[i] - newZ[i+1];
+                    Lanes distance = sqrt(dX * dX + dY * dY + dZ * dZ) - strandLength;
+                    Lanes scale = half * distance;
+                    newX[i] = newX[i] - scale * dX;
+                    newY[i] = newY[i] - scale * dY;
+                    newZ[i] = newZ[i] - scale * dZ;
+                    newX[i+1] = newX[i+1] + scale * dX;
+                    newY[i+1] = newY[i+1] + scale * dY;
+                    newZ[i+1] = newZ[i+1] + scale * dZ;
+                }
+            }
+        }
+
+        for(int i = 0; i < n; i++) {
+            const int offset = base + i * L;
+            newX[i].store(blocks.next[0] + offset);
+            newY[i].store(blocks.next[1] + offset);
+            newZ[i].store(blocks.next[2] + offset);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef HAIR_SNAPSHOT_H
+#define HAIR_SNAPSHOT_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// How far a run may drift from its golden snapshot. Distances are in world units,
+// the segment length error relative to the rest length of a segment.
+struct HairSnapshotTolerances
+{
+    double maxDeviation = 1e-3;
+    double rmsDeviation = 1e-4;
+    double segmentLengthError = 1e-2;
+};
+
+struct HairSnapshotComparison
+{
+    bool sameShape = false;            // strand and vertex counts agree
+    double maxDeviation = 0.0;         // largest distance of a vertex from its golden position
+    double rmsDeviation = 0.0;         // root mean square of these distances
+    double maxSegmentLengthError = 0.0; // largest change of a segment length over the rest length
+    int worstStrand = -1;              // strand of maxDeviation
+    bool passed = false;
+};
+
+// Strand positions at the end of a fixed run, kept as the golden reference later
+// runs of a changed or different solver are compared against. The app stores the
+// GPU state after a headless run (--golden-record, --golden-check), hair_bench the
+// state of the CPU solvers.
+//
+// The file holds a header and the positions as vec4 in the createMasterHairs()
+// layout. The w components are not compared.
+class HairSnapshot
+{
+public:
+    static const uint32_t magic = 0x53475348; // "HSGS"
+    static const uint32_t version = 1;
+
+    HairSnapshot();
+    HairSnapshot(int noOfMasterHairs, int verticesPerStrand, float restSegmentLength, int steps);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    HairSnapshotComparison compare(const HairSnapshot& result, const HairSnapshotTolerances& tolerances) const;
+
+    // One line per comparison with the tolerance it is held to
+    static void printComparison(std::ostream& out, const std::string& name, const HairSnapshotComparison& comparison,
+                                const HairSnapshotTolerances& tolerances);
+
+    int getNoOfMasterHairs() const{
+        return noOfMasterHairs;
+    }
+
+    int getVerticesPerStrand() const{
+        return verticesPerStrand;
+    }
+
+    float getRestSegmentLength() const{
+        return restSegmentLength;
+    }
+
+    // Frames or simulation steps of the run
+    int getSteps() const{
+        return steps;
+    }
+
+    float* getPositions(){
+        return positions.data();
+    }
+
+    const float* getPositions() const{
+        return positions.data();
+    }
+
+private:
+    int noOfMasterHairs;
+    int verticesPerStrand;
+    float restSegmentLength;
+    int steps;
+    std::vector<float> positions;
+};
+
+#endif
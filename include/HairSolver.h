@@ -0,0 +1,132 @@
+#ifndef HAIR_SOLVER_H
+#define HAIR_SOLVER_H
+
+#include <glm.hpp>
+
+#include <vector>
+
+class StrandScheduler;
+
+// How the length constraint stage keeps segments at hairStrandLength
+enum HairLengthConstraintMode {
+    HAIR_LENGTH_ITERATIVE, // pairwise corrections, repeated lengthConstraintIterations times
+    HAIR_LENGTH_FTL        // one root-to-tip follow-the-leader sweep with velocity correction (DFTL)
+};
+
+// Parameters of one simulation step. These are the values main.cpp passes to
+// HairSimulation.comp every frame, as uniforms or in the row of the asset in the
+// asset table (HairAssets.h).
+struct HairSolverParameters
+{
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    float timeStep = 0.03f;
+    float damping = 0.0f;
+    float hairStrandLength = 0.005f;
+    // Scales the wind velocity of windDirection; the kernels get it as the mean of
+    // the wind field (WindField.h)
+    float windMagnitude = 1.0f;
+    glm::vec4 windDirection = glm::vec4(0.0f, -1.0f, 1.0f, 0.0f);
+    // LOCAL_SHAPE_ITERATIONS and LENGTH_CONSTRAINT_ITERATIONS of the shader variant
+    int localShapeIterations = 5;
+    int lengthConstraintIterations = 5; // HAIR_LENGTH_ITERATIVE only
+    HairLengthConstraintMode lengthConstraintMode = HAIR_LENGTH_ITERATIVE;
+    // Share of the follow-the-leader correction of vertex i+1 that is removed from
+    // the velocity of vertex i (s_damping of DFTL), HAIR_LENGTH_FTL only
+    float ftlDamping = 0.9f;
+};
+
+// Keeps the follow-the-leader direction finite for coincident vertices; the
+// vertex then stays where it is. Same value as in the simulation kernels.
+const float hairFtlEpsilon = 1e-12f;
+
+// Wind velocity the solvers apply for windDirection. windForce() in the kernels
+// used to blend four directions around it with a factor that was always 0, leaving
+// w2 + w4; the GPU wind field (WindField.h) keeps this as its mean.
+inline glm::vec3 getUniformWind(const glm::vec4& windDirection)
+{
+    const glm::vec3 direction(windDirection);
+    const glm::vec3 c1(0.f, 1.f, 0.f);
+    const glm::vec3 c2 = glm::normalize(glm::cross(c1, direction));
+    return (direction + 0.2f * c1 - 0.2f * c2) + (direction - 0.2f * c1 - 0.2f * c2);
+}
+
+// CPU implementation of the hair simulation in shaders/HairSimulation.comp
+// (Han/Harada integration, global and local shape constraints, length constraints).
+// In HAIR_LENGTH_FTL mode a step also writes the velocity correction into the
+// current buffer, which becomes the previous one.
+//
+// The state is stored strand-major as a structure of arrays: the x, y and z
+// components live in separate arrays and vertex v of strand s is found at
+// s * verticesPerStrand + v. Three position buffers (previous, current, next) are
+// rotated by index after each step, so advancing the state never copies it.
+class HairSolver
+{
+public:
+    static const int maxVerticesPerStrand = 64;
+
+    // hairData is laid out the way createMasterHairs() produces it:
+    // noOfMasterHairs * verticesPerStrand vec4 positions, strand after strand.
+    // It is used as rest, previous and current state. An unsupported
+    // verticesPerStrand is reported and leaves the solver without strands.
+    HairSolver(const float* hairData, int noOfMasterHairs, int verticesPerStrand);
+
+    // Advances all strands one time step. With a scheduler the strands are
+    // split into cache-sized chunks and simulated on all of its workers.
+    void simulate(const HairSolverParameters& parameters, StrandScheduler* scheduler = nullptr);
+
+    // Advances strands [firstStrand, lastStrand) into the next buffer without
+    // rotating, so disjoint ranges can be simulated independently
+    void simulateStrands(int firstStrand, int lastStrand, const HairSolverParameters& parameters);
+
+    // Makes the next buffer current and the current buffer previous
+    void swapBuffers();
+
+    // Writes the current positions as vec4 in the createMasterHairs() layout
+    void getPositions(float* hairData) const;
+
+    int getNoOfMasterHairs() const{
+        return noOfMasterHairs;
+    }
+
+    int getVerticesPerStrand() const{
+        return verticesPerStrand;
+    }
+
+    // Vertex counts the solvers take, strands need a root and one more vertex
+    static bool isSupported(int verticesPerStrand){
+        return verticesPerStrand >= 2 && verticesPerStrand <= maxVerticesPerStrand;
+    }
+
+    // Bytes of state touched per strand and step (rest + three position buffers)
+    size_t getBytesPerStrand() const{
+        return 4 * 3 * sizeof(float) * (size_t)verticesPerStrand;
+    }
+
+private:
+    struct PositionBuffer
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+    };
+
+    int noOfMasterHairs;
+    int verticesPerStrand;
+
+    PositionBuffer rest;
+    PositionBuffer positions[3];
+    int previous; // index into positions of the previous time step
+    int current;  // index into positions of the current time step
+    int next;     // index into positions the next time step is written to
+};
+
+// Straight port of HairSimulation.comp working on the vec4 arrays createMasterHairs()
+// produces, one strand at a time. Kept as the scalar baseline the optimized solvers
+// are measured and checked against. Unsupported vertex counts (see
+// HairSolver::isSupported()) are reported and nothing is written.
+void simulateHairReference(const glm::vec4* restPositions, const glm::vec4* previousPositions,
+                           glm::vec4* currentPositions, glm::vec4* newPositions,
+                           int noOfMasterHairs, int verticesPerStrand,
+                           const HairSolverParameters& parameters);
+
+#endif
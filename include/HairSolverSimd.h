@@ -0,0 +1,133 @@
+#ifndef HAIR_SOLVER_SIMD_H
+#define HAIR_SOLVER_SIMD_H
+
+#include "HairSolver.h"
+
+#include <vector>
+
+// Instruction sets the strand-lockstep kernel is compiled for
+enum HairSimdInstructionSet {
+    HAIR_SIMD_GENERIC, // 4 lanes, plain C++ (used on non-x86 targets)
+    HAIR_SIMD_SSE,     // 4 lanes
+    HAIR_SIMD_AVX2,    // 8 lanes
+    HAIR_SIMD_AVX512   // 16 lanes
+};
+
+// Block-interleaved view of the hair state handed to a kernel. Strands are
+// grouped in blocks of `lanes` strands; component c of vertex v of lane l in
+// block b is stored at component[c][(b * verticesPerStrand + v) * lanes + l].
+struct HairSimdBlocks
+{
+    int noOfBlocks;
+    int verticesPerStrand;
+    const float* rest[3];
+    const float* previous[3];
+    float* current[3]; // receives the velocity correction in HAIR_LENGTH_FTL mode
+    float* next[3];
+};
+
+// HairSolverParameters reduced to the plain values a kernel needs. HairSolverSimd
+// computes them, so the instruction set specific translation units call no glm or
+// other inline functions: at -O0 those are emitted as weak symbols, and the linker
+// could keep the AVX-512 copy for every other caller.
+struct HairSimdStep
+{
+    float modelMatrix[4][3]; // columns of the model matrix, without the w row
+    float wind[3];           // windMagnitude * getUniformWind(windDirection)
+    float timeStep2;
+    float velocityScale;     // 1 - damping
+    float hairStrandLength;
+    float ftlDamping;
+    int localShapeIterations;
+    int lengthConstraintIterations;
+    HairLengthConstraintMode lengthConstraintMode;
+};
+
+typedef void (*HairSimdKernel)(const HairSimdBlocks& blocks, int firstBlock, int lastBlock,
+                               const HairSimdStep& step);
+
+// Kernels of the instruction set specific translation units. They return
+// nullptr when the translation unit was compiled without the instruction set.
+HairSimdKernel getHairSimdKernelSse();
+HairSimdKernel getHairSimdKernelAvx2();
+HairSimdKernel getHairSimdKernelAvx512();
+
+// Vectorized version of HairSolver. Strands are transposed into lane-interleaved
+// blocks and every block of 4/8/16 strands is advanced in lockstep, one strand
+// per SIMD lane. The widest instruction set the CPU supports is picked at runtime.
+// Like HairSolver it holds no strands for an unsupported verticesPerStrand.
+class HairSolverSimd
+{
+public:
+    HairSolverSimd(const float* hairData, int noOfMasterHairs, int verticesPerStrand);
+
+    // Same as above, but forces an instruction set (falls back to the best
+    // supported one if the requested one is not available)
+    HairSolverSimd(const float* hairData, int noOfMasterHairs, int verticesPerStrand,
+                   HairSimdInstructionSet instructionSet);
+
+    // Advances all strands one time step, on all workers of the scheduler if given
+    void simulate(const HairSolverParameters& parameters, StrandScheduler* scheduler = nullptr);
+
+    // Advances blocks [firstBlock, lastBlock) into the next buffer without rotating
+    void simulateBlocks(int firstBlock, int lastBlock, const HairSolverParameters& parameters);
+
+    // Makes the next buffer current and the current buffer previous
+    void swapBuffers();
+
+    // Writes the current positions as vec4 in the createMasterHairs() layout
+    void getPositions(float* hairData) const;
+
+    int getNoOfMasterHairs() const{
+        return noOfMasterHairs;
+    }
+
+    int getVerticesPerStrand() const{
+        return verticesPerStrand;
+    }
+
+    int getNoOfBlocks() const{
+        return noOfBlocks;
+    }
+
+    int getLanes() const{
+        return lanes;
+    }
+
+    // Bytes of state touched per block and step (rest + three position buffers)
+    size_t getBytesPerBlock() const{
+        return 4 * 3 * sizeof(float) * (size_t)verticesPerStrand * lanes;
+    }
+
+    HairSimdInstructionSet getInstructionSet() const{
+        return instructionSet;
+    }
+
+    // Widest instruction set that is both compiled in and supported by this CPU
+    static HairSimdInstructionSet getBestInstructionSet();
+    static bool isSupported(HairSimdInstructionSet instructionSet);
+    static int getLanes(HairSimdInstructionSet instructionSet);
+    static const char* getName(HairSimdInstructionSet instructionSet);
+
+private:
+    void init(const float* hairData, HairSimdInstructionSet requested);
+    HairSimdBlocks getBlocks();
+
+    static HairSimdStep getStep(const HairSolverParameters& parameters);
+
+    int noOfMasterHairs;
+    int verticesPerStrand;
+    int noOfBlocks;
+    int lanes;
+    HairSimdInstructionSet instructionSet;
+    HairSimdKernel kernel;
+
+    // x, y and z of every buffer, block-interleaved
+    std::vector<float> rest[3];
+    std::vector<float> positions[3][3];
+    int previous;
+    int current;
+    int next;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef HAIR_STATE_BUFFERS_H
+#define HAIR_STATE_BUFFERS_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <ostream>
+#include <string>
+
+class HairAssets;
+
+// How hair vertex positions are stored on the GPU
+enum HairStorageFormat {
+    HAIR_STORAGE_FP32, // vec4, 16 bytes per vertex
+    HAIR_STORAGE_FP16  // four halfs packed in a uvec2, 8 bytes per vertex
+};
+
+// Which simulated state a frame renders
+enum HairRenderLatency {
+    HAIR_RENDER_ZERO_LATENCY,     // the state the frame simulated, after a barrier on its dispatches
+    HAIR_RENDER_ONE_FRAME_LATENCY // the state the previous frame simulated, drawn before the frame simulates
+};
+
+// GPU hair state: rest positions plus four position slots (six with one frame of
+// render latency) in shader storage buffers with std430 layout. Vertex v of strand
+// s is element s * verticesPerStrand + v.
+//
+// The roles of the slots are indices, so shifting the history after a step moves
+// no data:
+//  - previous, current: read by a step, next: written by it
+//  - history: receives the velocity corrected current positions of the
+//    follow-the-leader length constraint. It is the current slot itself unless
+//    that one is pinned.
+//  - pinned: state at the start of the last full simulation step. The renderer
+//    interpolates between it and the current state, so no step may write it.
+// The simulation kernels access the slots as SSBOs (bindings 0-4, see
+// bindForSimulation()); the render pipeline reads them through buffer textures
+// over the same buffers.
+//
+// With one frame of render latency presentRenderState() keeps the pinned and the
+// current slot of the end of a frame as the render slots. The next frame draws
+// them while its own dispatches already rotate the other slots; no step writes a
+// render slot until the following presentRenderState(), so nothing is copied and
+// nothing waits. The two extra slots this takes are allocated on first use.
+//
+// Sleeping strands (HairActivity.h) are not written, so every slot has to hold
+// their settled positions. Steps write the free slot that was written least
+// recently, which cycles through all slots.
+class HairStateBuffers
+{
+public:
+    // hairData is laid out the way createMasterHairs() produces it. With assets,
+    // the position slots start at the rest pose placed by the model matrix of the
+    // asset of each strand, otherwise at the object space rest pose.
+    HairStateBuffers(const GLfloat* hairData, int noOfMasterHairs, int verticesPerStrand,
+                     HairStorageFormat format, const HairAssets* assets = nullptr);
+    ~HairStateBuffers();
+
+    HairStateBuffers(const HairStateBuffers&) = delete;
+    HairStateBuffers& operator=(const HairStateBuffers&) = delete;
+
+    // Picks the next and history slots and binds rest, previous, current, next and
+    // history positions to SSBO bindings 0-4. correctsHistory tells whether the
+    // kernel writes the history binding (follow-the-leader length constraint).
+    void bindForSimulation(bool correctsHistory);
+
+    // Makes the next slot current and the history slot previous. Call after the
+    // simulation dispatch, rendering then sees the new positions.
+    void swapBuffers();
+
+    // Keeps the current state for render interpolation, call at the start of
+    // every full simulation step (before its first substep)
+    void pinRenderState();
+
+    // Binds the current positions and the pinned positions as samplerBuffer
+    // to the given texture units. With one frame of latency these are the render
+    // slots of the last presentRenderState() call.
+    void bindForRendering(int textureUnit, int pinnedTextureUnit);
+
+    // Switching to one frame of latency allocates the extra slots, until the first
+    // presentRenderState() the current and the pinned slot are rendered
+    void setRenderLatency(HairRenderLatency latency);
+
+    HairRenderLatency getRenderLatency() const{
+        return latency;
+    }
+
+    // Call after the last dispatch of a frame. With one frame of latency the
+    // current and the pinned slot become the render slots, which the steps of the
+    // next frame leave alone; without latency it does nothing.
+    void presentRenderState();
+
+    // Reads the current positions back as vec4 in the createMasterHairs() layout,
+    // waiting for the dispatches that write them. For checks, not for every frame.
+    void getPositions(GLfloat* hairData) const;
+
+    HairStorageFormat getFormat() const{
+        return format;
+    }
+
+    size_t getBytesPerVertex() const{
+        return getBytesPerVertex(format);
+    }
+
+    // Size of the rest buffer or of one slot
+    size_t getBufferSize() const{
+        return getBufferSize(format);
+    }
+
+    // Size of the rest buffer and all allocated slots
+    size_t getMemoryFootprint() const{
+        return getMemoryFootprint(format);
+    }
+
+    // Bytes one simulation dispatch reads and writes. A frame runs one dispatch per
+    // substep of every step it simulates.
+    size_t getSimulationBytesPerDispatch(bool correctsHistory) const{
+        return getSimulationBytesPerDispatch(format, correctsHistory);
+    }
+
+    // Footprint and traffic per dispatch of these strands in both formats
+    void printMemoryReport(std::ostream& out) const;
+
+    // #defines the simulation kernels have to be compiled with for this format
+    static std::string getShaderDefines(HairStorageFormat format);
+    static const char* getName(HairStorageFormat format);
+    static size_t getBytesPerVertex(HairStorageFormat format);
+
+private:
+    static const int NO_OF_SLOTS = 4;
+    static const int NO_OF_RENDER_SLOTS = 2;
+    static const int MAX_SLOTS = NO_OF_SLOTS + NO_OF_RENDER_SLOTS; // HairActivity::minSleepSteps
+
+    // The slot written least recently that is none of the given ones
+    int getFreeSlot(int a, int b, int c, int d, int e) const;
+
+    // The sizes above if the strands were stored in the given format
+    size_t getBufferSize(HairStorageFormat format) const;
+    size_t getMemoryFootprint(HairStorageFormat format) const;
+    size_t getSimulationBytesPerDispatch(HairStorageFormat format, bool correctsHistory) const;
+
+    int noOfMasterHairs;
+    int verticesPerStrand;
+    HairStorageFormat format;
+    GLuint restBuffer;
+    int noOfSlots;
+    GLuint positionBuffers[MAX_SLOTS];
+    GLuint positionTextures[MAX_SLOTS]; // buffer textures over positionBuffers
+    unsigned lastWrite[MAX_SLOTS];      // writeCount when a step last wrote the slot
+    unsigned writeCount;
+    int previous;
+    int current;
+    int next;
+    int history;
+    int pinned;
+
+    HairRenderLatency latency;
+    // Current and pinned slot of the last presentRenderState(), -1 before the first
+    int renderCurrent;
+    int renderPinned;
+};
+
+#endif
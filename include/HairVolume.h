@@ -0,0 +1,89 @@
+#ifndef HAIR_VOLUME_H
+#define HAIR_VOLUME_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "shader_c.h"
+
+// Hair-hair interaction through a voxel grid (Petrovic et al., TressFX).
+//
+// Every dispatch HairVolumeSplat.comp splats the density and the velocity of all
+// hair vertices trilinearly into the grid, with integer atomics on fixed point
+// values, and HairVolumeResolve.comp turns the sums into two 3D textures:
+//  - volume: mean velocity per dispatch in rgb, density (vertices per cell) in a
+//  - gradient: object space gradient of the pressure in rgb, the density beyond a
+//    rest density
+// The simulation kernels then blend each vertex velocity towards the grid velocity
+// (friction, smoothing) and push vertices down the pressure gradient (repulsion),
+// at two texture fetches per vertex. The cost grows with the number of vertices
+// and cells, never with pairs of strands.
+//
+// The grid covers the object space bounding box of the rest pose grown by padding
+// and follows the model matrix, which may only rotate and translate. With several
+// hair assets (HairAssets.h) every asset gets a slab of its own, so hair only
+// interacts with hair of the same asset; the slabs are stacked along z in the
+// buffer and in the textures and share the object space placement.
+//
+// GPU buffers, bound to the SSBO binding following HairLod:
+// 11 cells: density and velocity xyz per cell, fixed point ints, slab after slab
+class HairVolume
+{
+public:
+    static const int splatGroupSize = 64;  // local_size_x of HairVolumeSplat.comp
+    static const int resolveGroupSize = 4; // local size in x, y and z of HairVolumeResolve.comp
+
+    // hairData is laid out the way createMasterHairs() produces it, in object space,
+    // the strands of all noOfSlabs assets packed; maxResolution is the number of
+    // cells along the longest side of the grid
+    HairVolume(const GLfloat* hairData, int noOfMasterHairs, int verticesPerStrand, int maxResolution, float padding,
+               int noOfSlabs = 1);
+    ~HairVolume();
+
+    HairVolume(const HairVolume&) = delete;
+    HairVolume& operator=(const HairVolume&) = delete;
+
+    // Clears the grid and splats the current positions and velocities of all
+    // vertices; call with the simulation state and the asset tables bound
+    void dispatchSplat(ComputeShader& splatShader) const;
+
+    // Fills the volume and gradient textures from the splatted cells; restDensity
+    // is the density in vertices per cell up to which hair does not push
+    void dispatchResolve(ComputeShader& resolveShader, float restDensity) const;
+
+    // Binds the volume and gradient textures as sampler3D to the given texture units
+    void bindForSimulation(int volumeTextureUnit, int gradientTextureUnit) const;
+
+    // Maps object space positions to texture coordinates of one slab; the
+    // textures hold getNoOfSlabs() of them along z
+    const glm::mat4& getTextureMatrix() const{
+        return textureMatrix;
+    }
+
+    // Cells of one slab
+    glm::ivec3 getResolution() const{
+        return resolution;
+    }
+
+    int getNoOfSlabs() const{
+        return noOfSlabs;
+    }
+
+    float getCellSize() const{
+        return cellSize;
+    }
+
+private:
+    int noOfVertices;
+    int noOfSlabs;
+    glm::ivec3 resolution;
+    float cellSize;
+    glm::mat4 textureMatrix;
+    GLuint cellBuffer;
+    GLuint volumeTexture;
+    GLuint gradientTexture;
+};
+
+#endif
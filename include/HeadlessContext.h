@@ -0,0 +1,50 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// OpenGL 4.3 core context without a display, for render farm and CI runs. It is
+// a surfaceless EGL context (EGL_MESA_platform_surfaceless, works on Mesa
+// llvmpipe) drawing into an offscreen framebuffer that stands in for the window:
+// multisampled colour and depth renderbuffers of the window size, resolved into
+// a single sample framebuffer when a frame is saved.
+//
+// Only built with EGL (HAIR_HEADLESS_EGL, set by CMake when libEGL is found);
+// without it isValid() is always false.
+class HeadlessContext
+{
+public:
+    // Creates the context and makes it current. The framebuffer needs GL
+    // functions and is created by createFramebuffer() once GLEW is initialised.
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool isValid() const{
+        return context != nullptr;
+    }
+
+    void createFramebuffer(int width, int height, int samples);
+
+    // Makes the offscreen framebuffer the draw target, like the default one of a window
+    void bindFramebuffer() const;
+
+    // Resolves the frame drawn so far and writes it with SaveFramebufferToTGA
+    void saveFrame(const char* filename) const;
+
+private:
+    void* display; // EGLDisplay
+    void* context; // EGLContext
+    int width;
+    int height;
+    GLuint framebuffer;
+    GLuint colorRenderbuffer;
+    GLuint depthRenderbuffer;
+    GLuint resolveFramebuffer;
+    GLuint resolveRenderbuffer;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <glm.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct GLFWwindow;
+
+enum InputEventType {
+    INPUT_KEY,    // key went down (x = 1) or up (x = 0)
+    INPUT_CURSOR, // cursor moved to (x, y)
+    INPUT_SCROLL  // wheel scrolled by y
+};
+
+// One input event, time in seconds since the recording started
+struct InputEvent
+{
+    InputEventType type;
+    int key;
+    double x;
+    double y;
+    float time;
+};
+
+// What the input of a frame changes, after processInput() and the callbacks ran
+struct InputParameters
+{
+    glm::vec3 cameraPosition;
+    float cameraZoom;
+    glm::mat4 model;
+    float windAmount;
+    float hairStrandLength;
+};
+
+enum InputMode {
+    INPUT_LIVE,   // GLFW input, wall clock frame times
+    INPUT_RECORD, // like live, every frame is also written to the log
+    INPUT_REPLAY  // input and parameters from the log, fixed frame time
+};
+
+// Records the input of every frame to a compact binary log and plays it back.
+//
+// The log holds, per frame, the measured frame time, the key transitions and cursor
+// and scroll events of the frame and the parameter values they produced. Keys are
+// recorded as processInput() polls them through isKeyDown(), so only the keys the
+// application looks at are logged, and only when they change.
+//
+// A replay ignores the window input and the wall clock: every frame lasts the fixed
+// replay frame time, key state comes from the logged transitions and the parameters
+// of each frame are set to the logged values, so that frame time dependent input
+// (camera movement) lands exactly where it was recorded. Two replays of a log run
+// the same workload.
+class InputRecorder
+{
+public:
+    InputRecorder();
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    // Both return false and stay live if the file cannot be opened or is no log
+    bool startRecording(const std::string& path);
+    bool startReplay(const std::string& path, float frameSeconds);
+
+    InputMode getMode() const{
+        return mode;
+    }
+
+    // Gives live and recorded frames a fixed frame time instead of the measured one,
+    // 0 measures again. Replays always use their own.
+    void setFrameTime(float frameSeconds){
+        fixedFrameSeconds = frameSeconds;
+    }
+
+    // Starts a frame at the given wall clock time and returns its frame time: the
+    // measured one, or the fixed one in a replay. A replay loads the events of the
+    // frame here; isFinished() is true once the log is exhausted.
+    float beginFrame(double wallSeconds);
+
+    // Time of the current frame: wall clock, or the sum of the replayed frame times
+    double getTime() const{
+        return time;
+    }
+
+    // glfwGetKey() == GLFW_PRESS, recorded; the logged state in a replay. Without
+    // a window (headless) no key is down.
+    bool isKeyDown(GLFWwindow* window, int key);
+
+    // Called from the GLFW callbacks with the clock beginFrame() gets, ignored in a replay
+    void recordCursor(double x, double y, double wallSeconds);
+    void recordScroll(double y, double wallSeconds);
+
+    // Cursor and scroll events of the replayed frame, in recorded order. The
+    // application feeds them to its callback handlers before processInput().
+    const std::vector<InputEvent>& getFrameEvents() const{
+        return frameEvents;
+    }
+
+    // Ends the input of a frame: a recording writes the frame to the log, a replay
+    // overwrites parameters with the logged values
+    void endInput(InputParameters& parameters);
+
+    bool isFinished() const{
+        return finished;
+    }
+
+    // Frames begun since recording or replay started
+    int getFrame() const{
+        return frame;
+    }
+
+private:
+    static const uint32_t magic = 0x52495348; // "HSIR"
+    static const uint32_t version = 1;
+
+    bool readFrame();
+    void close();
+    // Seconds since the recording started
+    float getEventTime(double wallSeconds) const;
+
+    InputMode mode;
+    std::ofstream recording;
+    std::ifstream replay;
+    float frameSeconds;    // replay
+    float fixedFrameSeconds; // live and recording, 0 if measured
+    double startSeconds;   // wall clock at the first recorded frame
+    double time;
+    float deltaTime;
+    int frame;
+    bool finished;
+    std::vector<InputEvent> frameEvents;   // recording: events of the frame so far, replay: cursor and scroll events
+    std::vector<int> keysDown;             // replay
+    std::vector<std::pair<int, bool> > keyStates; // recording: last polled state per key
+    InputParameters replayParameters;
+};
+
+#endif
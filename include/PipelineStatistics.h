@@ -0,0 +1,75 @@
+#ifndef PIPELINE_STATISTICS_H
+#define PIPELINE_STATISTICS_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <ostream>
+
+// ARB_pipeline_statistics_query counters around the hair draws of a frame: how
+// many patches Hair.tesc receives, how many vertices its tessellation levels make
+// Hair.tese produce, how many strands Hair.geom expands into line strips and how
+// many of their segments reach the rasterizer and shade fragments.
+//
+// Like GpuProfiler the queries rotate over framesInFlight frames and a frame is
+// only read back when the GPU has finished it. Without the extension isSupported()
+// is false and begin() and end() do nothing.
+class PipelineStatistics
+{
+public:
+    static const int framesInFlight = 4;
+
+    enum Counter {
+        TESS_CONTROL_PATCHES,          // patches entering Hair.tesc
+        TESS_EVALUATION_INVOCATIONS,   // tessellated vertices, Hair.tese invocations
+        GEOMETRY_INVOCATIONS,          // Hair.geom invocations (three per tessellated triangle)
+        GEOMETRY_PRIMITIVES_EMITTED,   // primitives written by Hair.geom
+        CLIPPING_INPUT_PRIMITIVES,     // segments entering clipping
+        CLIPPING_OUTPUT_PRIMITIVES,    // segments leaving clipping towards the rasterizer
+        FRAGMENT_INVOCATIONS,
+        NO_OF_COUNTERS
+    };
+
+    PipelineStatistics();
+    ~PipelineStatistics();
+
+    PipelineStatistics(const PipelineStatistics&) = delete;
+    PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+
+    bool isSupported() const{
+        return supported;
+    }
+
+    // Around all hair draws of a frame, once per frame. begin() first collects the
+    // oldest frame in flight if it has finished.
+    void begin();
+    void end();
+
+    // Counters of the latest frame read back, 0 before the first one
+    GLuint64 getCounter(Counter counter) const{
+        return counters[counter];
+    }
+
+    bool hasResults() const{
+        return measuredFrames > 0;
+    }
+
+    static const char* getName(Counter counter);
+
+    // The counters next to the strand and vertex counts of the draw, all strands of
+    // all assets whether simulated, interpolated by the level of detail or asleep
+    void print(std::ostream& out, int noOfStrands, int verticesPerStrand) const;
+
+private:
+    void collect(int frame);
+
+    bool supported;
+    GLuint queries[framesInFlight][NO_OF_COUNTERS];
+    bool pending[framesInFlight];
+    int currentFrame;
+    bool running;
+    GLuint64 counters[NO_OF_COUNTERS];
+    int measuredFrames;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "shader_c.h"
+#include "shader_t.h"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+// Builds the #define block a shader variant is compiled with, e.g.
+//     ShaderDefines().define("VERTICES_PER_STRAND", 16).define("HAIR_STATE_FP16").str()
+class ShaderDefines
+{
+public:
+    ShaderDefines& define(const std::string& name)
+    {
+        defines += "#define " + name + "\n";
+        return *this;
+    }
+
+    ShaderDefines& define(const std::string& name, int value)
+    {
+        defines += "#define " + name + " " + std::to_string(value) + "\n";
+        return *this;
+    }
+
+    // appends an already formatted block of #define lines
+    ShaderDefines& append(const std::string& lines)
+    {
+        defines += lines;
+        return *this;
+    }
+
+    const std::string& str() const
+    {
+        return defines;
+    }
+
+private:
+    std::string defines;
+};
+
+// Compiles every (source files, defines) combination once and keeps the programs
+// for the lifetime of the cache, so switching between variants at runtime only
+// costs a compile the first time a variant is used.
+class ShaderVariantCache
+{
+public:
+    ComputeShader& getComputeShader(const char* computePath, const std::string& defines = "")
+    {
+        std::string key = std::string(computePath) + '\n' + defines;
+        std::unique_ptr<ComputeShader>& variant = computeShaders[key];
+        if(!variant) {
+            printVariant(computePath, defines);
+            variant.reset(new ComputeShader(computePath, defines));
+        }
+        return *variant;
+    }
+
+    Shader& getShader(const char* vertexPath, const char* fragmentPath, const char* geometryPath,
+                      const char* tessControlPath, const char* tessEvalPath, const std::string& defines = "")
+    {
+        std::string key = std::string(vertexPath) + '\n' + fragmentPath + '\n' +
+                          (geometryPath ? geometryPath : "") + '\n' +
+                          (tessControlPath ? tessControlPath : "") + '\n' +
+                          (tessEvalPath ? tessEvalPath : "") + '\n' + defines;
+        std::unique_ptr<Shader>& variant = shaders[key];
+        if(!variant) {
+            printVariant(vertexPath, defines);
+            variant.reset(new Shader(vertexPath, fragmentPath, geometryPath, tessControlPath, tessEvalPath, defines));
+        }
+        return *variant;
+    }
+
+    size_t getNoOfVariants() const
+    {
+        return computeShaders.size() + shaders.size();
+    }
+
+private:
+    static void printVariant(const char* path, const std::string& defines)
+    {
+        std::string flat = defines;
+        for(char& c : flat)
+            if(c == '\n')
+                c = ' ';
+        std::cout << "Compiling shader variant " << path << (flat.empty() ? "" : " with ") << flat << std::endl;
+    }
+
+    std::map<std::string, std::unique_ptr<ComputeShader>> computeShaders;
+    std::map<std::string, std::unique_ptr<Shader>> shaders;
+};
+
+#endif
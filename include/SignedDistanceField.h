@@ -0,0 +1,93 @@
+#ifndef SIGNED_DISTANCE_FIELD_H
+#define SIGNED_DISTANCE_FIELD_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "StrandScheduler.h"
+
+#include <vector>
+
+// Signed distance field of a closed triangle mesh for the hair body collisions,
+// baked on the CPU and sampled by the simulation kernels from a 3D texture.
+//
+// Every texel holds the outward direction to the nearest surface point in rgb and
+// the signed distance in a (negative inside), both in object space, so a vertex
+// needs a single trilinear fetch to be projected out of the body.
+//
+// The bake follows the usual mesh to level set construction:
+//  1. exact distances to the triangles near each voxel,
+//  2. the nearest triangle propagated to the remaining voxels, row by row along
+//     x, y and z,
+//  3. inside/outside by counting the crossings of a ray along x.
+// All stages run on the StrandScheduler, the x/y/z rows and z slices are independent.
+//
+// positions holds vertices of stride floats each, starting with xyz (the Sphere
+// vertex array has stride 8, the vec3 array of an OBJ Model stride 3); indices
+// holds three vertex indices per triangle.
+class SignedDistanceField
+{
+public:
+    // maxResolution is the number of voxels along the longest side of the bounding
+    // box, which is grown by padding on every side
+    SignedDistanceField(const GLfloat* positions, int stride, const GLuint* indices, int noOfTriangles,
+                        int maxResolution, float padding, StrandScheduler& scheduler);
+    ~SignedDistanceField();
+
+    SignedDistanceField(const SignedDistanceField&) = delete;
+    SignedDistanceField& operator=(const SignedDistanceField&) = delete;
+
+    // Maps object space positions to texture coordinates of the field
+    const glm::mat4& getTextureMatrix() const{
+        return textureMatrix;
+    }
+
+    glm::ivec3 getResolution() const{
+        return resolution;
+    }
+
+    float getVoxelSize() const{
+        return voxelSize;
+    }
+
+    // Wall time of the bake
+    double getBakeSeconds() const{
+        return bakeSeconds;
+    }
+
+    // Signed distance at the center of voxel (i, j, k)
+    float getDistance(int i, int j, int k) const{
+        return distances[voxelIndex(i, j, k)];
+    }
+
+    // Binds the field as sampler3D to the given texture unit
+    void bind(int textureUnit) const;
+
+private:
+    void bake(const GLfloat* positions, int stride, const GLuint* indices, int noOfTriangles,
+              int maxResolution, float padding, StrandScheduler& scheduler);
+    void propagate(int axis, StrandScheduler& scheduler);
+
+    int voxelIndex(int i, int j, int k) const{
+        return (k * resolution.y + j) * resolution.x + i;
+    }
+
+    glm::vec3 voxelCenter(int i, int j, int k) const{
+        return origin + voxelSize * (glm::vec3(i, j, k) + 0.5f);
+    }
+
+    glm::ivec3 resolution;
+    glm::vec3 origin; // object space corner of voxel (0, 0, 0)
+    float voxelSize;
+    glm::mat4 textureMatrix;
+    double bakeSeconds;
+
+    std::vector<glm::vec3> triangles;   // three corners per triangle
+    std::vector<float> distances;       // per voxel
+    std::vector<int> closestTriangles;  // per voxel, -1 before it was reached
+    GLuint texture;
+};
+
+#endif
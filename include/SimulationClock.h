@@ -0,0 +1,78 @@
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+// Fixed timestep clock for the hair simulation. Rendered frame times are collected
+// in an accumulator and paid out as whole simulation steps, so the simulation
+// advances in real time at 1 / stepSeconds Hz whatever the display refresh rate is.
+// A step can be split into substeps with a smaller time step. At most
+// maxStepsPerFrame steps are run per frame; time beyond that is dropped, so a
+// slow frame does not make the next one slower still.
+//
+// Rendering shows the state getInterpolation() of the way from the start to the
+// end of the last step, i.e. the simulation is shown one step late.
+class SimulationClock
+{
+public:
+    SimulationClock(float stepSeconds, int substeps = 1, int maxStepsPerFrame = 4)
+        : stepSeconds(stepSeconds), substeps(substeps), maxStepsPerFrame(maxStepsPerFrame),
+          accumulator(0.f), droppedSeconds(0.f)
+    {
+    }
+
+    // Adds the duration of a rendered frame and returns the number of steps to run
+    int advance(float frameSeconds)
+    {
+        accumulator += frameSeconds;
+        int steps = int(accumulator / stepSeconds);
+        accumulator -= steps * stepSeconds;
+        if(steps > maxStepsPerFrame) {
+            droppedSeconds += (steps - maxStepsPerFrame) * stepSeconds;
+            steps = maxStepsPerFrame;
+        }
+        return steps;
+    }
+
+    // Share of the next step that has already elapsed, in [0, 1)
+    float getInterpolation() const{
+        return accumulator / stepSeconds;
+    }
+
+    float getStepSeconds() const{
+        return stepSeconds;
+    }
+
+    // Time step of one kernel dispatch
+    float getSubstepSeconds() const{
+        return stepSeconds / substeps;
+    }
+
+    int getSubsteps() const{
+        return substeps;
+    }
+
+    void setSubsteps(int substeps){
+        this->substeps = substeps < 1 ? 1 : substeps;
+    }
+
+    int getMaxStepsPerFrame() const{
+        return maxStepsPerFrame;
+    }
+
+    void setMaxStepsPerFrame(int maxStepsPerFrame){
+        this->maxStepsPerFrame = maxStepsPerFrame < 1 ? 1 : maxStepsPerFrame;
+    }
+
+    // Frame time that was not simulated because of the step cap
+    float getDroppedSeconds() const{
+        return droppedSeconds;
+    }
+
+private:
+    float stepSeconds;
+    int substeps;
+    int maxStepsPerFrame;
+    float accumulator;
+    float droppedSeconds;
+};
+
+#endif
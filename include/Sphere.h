@@ -28,6 +28,14 @@ public:
         return nverts;
     }
 
+    GLuint* getIndexArray() const{
+        return indexarray;
+    }
+
+    int getNoOfTriangles() const{
+        return ntris;
+    }
+
     //Used to render the geometry
     //mode : Specifies what kind of primitives to render
     void draw(GLenum mode);
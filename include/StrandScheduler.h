@@ -0,0 +1,96 @@
+#ifndef STRAND_SCHEDULER_H
+#define STRAND_SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Time and work done by one worker since the statistics were last reset
+struct StrandWorkerStats
+{
+    double busySeconds = 0.0; // time spent inside work items
+    long chunks = 0;          // chunks executed
+    long stolenChunks = 0;    // chunks taken from another worker's queue
+};
+
+// Work-stealing thread pool for independent ranges of strands.
+//
+// parallelFor() cuts [0, count) into chunks and hands every worker a contiguous
+// run of them. A worker takes chunks from the front of its own queue, in strand
+// order, and once it is empty steals from the back of the others, away from where
+// their owners work, so strands that cost more than others (collisions, extra
+// iterations) are rebalanced automatically. The calling thread takes part as
+// worker 0.
+class StrandScheduler
+{
+public:
+    // noOfWorkers <= 0 uses one worker per hardware thread
+    explicit StrandScheduler(int noOfWorkers = 0);
+    ~StrandScheduler();
+
+    StrandScheduler(const StrandScheduler&) = delete;
+    StrandScheduler& operator=(const StrandScheduler&) = delete;
+
+    // Calls work(first, last, worker) for every chunk and returns when all are done
+    void parallelFor(int count, int chunkSize, const std::function<void(int, int, int)>& work);
+
+    // Number of items of bytesPerItem that fit in cacheBytes (at least one)
+    static int getChunkSize(size_t bytesPerItem, size_t cacheBytes = 128 * 1024);
+
+    int getNoOfWorkers() const{
+        return (int)workers.size();
+    }
+
+    const StrandWorkerStats& getWorkerStats(int worker) const{
+        return workers[worker]->stats;
+    }
+
+    // Wall time spent in parallelFor() since the statistics were last reset
+    double getElapsedSeconds() const{
+        return elapsedSeconds;
+    }
+
+    void resetStats();
+
+    // Prints busy time / elapsed time, chunks and steals of every worker
+    void printUtilisation(std::ostream& out) const;
+
+private:
+    struct Chunk
+    {
+        int first;
+        int last;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Chunk> chunks;
+        StrandWorkerStats stats;
+    };
+
+    void workerLoop(int worker);
+    void runChunks(int worker);
+    bool popChunk(int worker, Chunk& chunk);
+    bool stealChunk(int worker, Chunk& chunk);
+
+    std::vector<Worker*> workers;
+    std::vector<std::thread> threads;
+
+    // Current job, published under jobMutex by bumping jobGeneration
+    std::mutex jobMutex;
+    std::condition_variable jobStarted;
+    std::condition_variable jobFinished;
+    const std::function<void(int, int, int)>* job;
+    long jobGeneration;
+    int workersInJob;
+    bool quit;
+
+    double elapsedSeconds;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef WIND_FIELD_H
+#define WIND_FIELD_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <glm.hpp>
+
+#include "shader_c.h"
+
+// Animated wind velocity on a coarse world space grid, a box that is fitted around
+// the hair of all assets every update. HairWind.comp fills it once per frame with the mean
+// wind plus curl noise gusts that drift along with the mean wind; the simulation
+// kernels read the wind at each vertex with a single trilinear fetch.
+class WindField
+{
+public:
+    static const int updateGroupSize = 4; // local size in x, y and z of HairWind.comp
+
+    // resolution cells along each side of the box
+    explicit WindField(int resolution);
+    ~WindField();
+
+    WindField(const WindField&) = delete;
+    WindField& operator=(const WindField&) = delete;
+
+    // Evaluates the wind at the simulated time in the box from lower to upper. The gusts
+    // drift with meanWind over the time since the last update. The other gust
+    // parameters are uniforms of windShader and are set by the caller.
+    void dispatchUpdate(ComputeShader& windShader, const glm::vec3& lower, const glm::vec3& upper,
+                        const glm::vec3& meanWind, float time);
+
+    // Maps world space positions to texture coordinates of the last update
+    const glm::mat4& getTextureMatrix() const{
+        return textureMatrix;
+    }
+
+    // Binds the field as sampler3D to the given texture unit
+    void bind(int textureUnit) const;
+
+private:
+    int resolution;
+    glm::mat4 textureMatrix;
+    glm::vec3 gustOffset;
+    float updateTime; // simulated time of the last update
+    GLuint texture;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 //#include <glad/glad.h>
 #include <glm.hpp>
+#include "CpuProfiler.h"
 
 #include <string>
 #include <fstream>
@@ -14,9 +15,11 @@ class ComputeShader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines (e.g. "#define HAIR_STATE_FP16\n") are inserted after the #version line
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath)
+    ComputeShader(const char* computePath, const std::string& defines = "")
     {
+        CPU_PROFILE_ZONE_DETAIL("ComputeShader", computePath);
         // 1. retrieve the vertex/fragment source code from filePath
         std::string computeCode;
         std::ifstream cShaderFile;
@@ -39,6 +42,7 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
+        insertDefines(computeCode, defines);
         const char* cShaderCode = computeCode.c_str();
         // 2. compile shaders
         unsigned int compute;
@@ -122,6 +126,15 @@ public:
     }
 
 private:
+    // inserts defines after the #version line, which has to stay the first line
+    // ------------------------------------------------------------------------
+    static void insertDefines(std::string& code, const std::string& defines)
+    {
+        if(defines.empty() || code.empty())
+            return;
+        size_t versionEnd = code.find('\n') + 1;
+        code.insert(versionEnd, defines);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
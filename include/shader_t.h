@@ -3,6 +3,7 @@
 
 //#include <glad/glad.h>
 #include <glm.hpp>
+#include "CpuProfiler.h"
 
 #include <string>
 #include <fstream>
@@ -14,10 +15,13 @@ class Shader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines (e.g. "#define VERTICES_PER_STRAND 16\n") are inserted after the #version line of every stage
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
-           const char* tessControlPath = nullptr, const char* tessEvalPath = nullptr)
+           const char* tessControlPath = nullptr, const char* tessEvalPath = nullptr,
+           const std::string& defines = "")
     {
+        CPU_PROFILE_ZONE_DETAIL("Shader", vertexPath);
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -78,6 +82,11 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        insertDefines(vertexCode, defines);
+        insertDefines(fragmentCode, defines);
+        insertDefines(geometryCode, defines);
+        insertDefines(tessControlCode, defines);
+        insertDefines(tessEvalCode, defines);
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -206,6 +215,15 @@ public:
     }
 
 private:
+    // inserts defines after the #version line, which has to stay the first line
+    // ------------------------------------------------------------------------
+    static void insertDefines(std::string& code, const std::string& defines)
+    {
+        if(defines.empty() || code.empty())
+            return;
+        size_t versionEnd = code.find('\n') + 1;
+        code.insert(versionEnd, defines);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
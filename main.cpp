@@ -1,5 +1,11 @@
 #include <iostream>
 #include <random>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <fstream>
 
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -15,16 +21,40 @@
 #include "Sphere.h"
 #include "shader_c.h"
 #include "shader_t.h"
+#include "ShaderVariants.h"
 #include "LoadTGA.h"
+#include "HairStateBuffers.h"
+#include "HairActivity.h"
+#include "HairLod.h"
+#include "HairVolume.h"
+#include "SignedDistanceField.h"
+#include "WindField.h"
+#include "HairForceFields.h"
+#include "HairAssets.h"
+#include "StrandScheduler.h"
+#include "HairSolver.h"
+#include "SimulationClock.h"
+#include "InputRecorder.h"
+#include "HeadlessContext.h"
+#include "GpuProfiler.h"
+#include "PipelineStatistics.h"
+#include "CpuProfiler.h"
+#include "HairSnapshot.h"
 
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+void moveCursor(double xpos, double ypos);
+void scroll(double yoffset);
+double getWallSeconds();
 
 GLfloat* createMasterHairs(const Sphere& object);
-GLuint generateTextureFromHairData(GLfloat* hairData);
+glm::mat4 getAssetModelMatrix(int asset);
+void getHairBounds(glm::vec3& lower, glm::vec3& upper);
+std::string getHairShaderDefines();
+int getStrandsPerWorkGroup();
 
 // Window dimensions
 const GLuint WIDTH = 2000, HEIGHT = 1100;
@@ -36,64 +66,253 @@ float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 
 // time variables
-float deltaTime = 0.0f; // time between current frame and last frame
-float lastFrame = 0.0f;
+float deltaTime = 0.0f; // time between current frame and last frame, fixed in a replay
+
+// Input of every frame, recorded with --record <file> and replayed with --replay <file>
+// (see InputRecorder.h)
+InputRecorder inputRecorder;
+float fixedFrameTime = 1.f / 60.f; // --frame-time <seconds>, frame time of replays and headless runs
+
+// Headless runs without a display (see HeadlessContext.h): --headless draws into an
+// offscreen framebuffer, --dump <prefix> saves every --dump-interval th frame as TGA
+bool headless = false;
+std::string dumpPrefix;
+int dumpInterval = 1;
+// Stop after --frames frames or --duration wall clock seconds, 0 runs on. A
+// headless run without either stops after defaultHeadlessFrames.
+int maxFrames = 0;
+float maxDuration = 0.f;
+const int defaultHeadlessFrames = 600;
+
+// GPU time per stage (see GpuProfiler.h) and the pipeline statistics of the hair draw
+// (see PipelineStatistics.h), printed with P. --gpu-profile <file> writes
+// the statistics every --gpu-profile-interval frames and at exit, as JSON if the
+// file name ends in .json and as CSV rows otherwise.
+std::string gpuProfilePath;
+int gpuProfileInterval = 300;
+bool printGpuProfile = false;
+bool gpuProfileKeyPressed = false;
+
+// --cpu-trace <file> writes the CPU zones (see CpuProfiler.h) from startup to exit as
+// a Chrome trace, with the GPU stages of GpuProfiler on their own row
+std::string cpuTracePath;
+
+// Golden state regression (see HairSnapshot.h): --golden-record <file> stores the
+// strand positions at the end of the run, --golden-check <file> compares them with
+// the stored ones and exits with 1 if they drift beyond the tolerances. Only a
+// headless run has the fixed frame time that makes runs repeatable.
+std::string goldenRecordPath;
+std::string goldenCheckPath;
+HairSnapshotTolerances goldenTolerances;
 
 // Light variables
 glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
 glm::vec3 lightPos(0.f, 0.f, 0.f);
 
 // Hair variables
-int verticesPerStrand = 15; // if this changed , it should be changed in compute shader and in geometry shader too
+int verticesPerStrand = 15; // compiled into the shaders as VERTICES_PER_STRAND, switched with V
+const int supportedVerticesPerStrand[] = {8, 15, 16, 32, 64};
+bool resolutionKeyPressed = false;
+bool resolutionChanged = false;
+int localShapeIterations = 5;       // LOCAL_SHAPE_ITERATIONS
+int lengthConstraintIterations = 5; // LENGTH_CONSTRAINT_ITERATIONS, iterative length constraint only
+// Length constraint of the first asset, toggled with F. Every asset has its own in
+// the asset table (HairAssets.h), the neighbours keep the iterative one.
+HairLengthConstraintMode lengthConstraintMode = HAIR_LENGTH_ITERATIVE;
+float ftlDamping = 0.9f;
+bool lengthModeKeyPressed = false;
 float hairStrandLength = 0.005f;
 const int dataVariablesPerMasterHair = 1; // position
 int noOfMasterHairs;
+// precision of the hair state buffers, --storage fp32|fp16 or switched with M
+HairStorageFormat hairStorageFormat = HAIR_STORAGE_FP32;
+bool storageKeyPressed = false;
 
 float damping = 0;
-float timeStep = 0.03;
+float timeStep = 0.03; // simulated seconds per step, the simulation runs at 1 / timeStep Hz in real time
+int simulationSubsteps = 1;         // kernel dispatches per step, each advancing timeStep / simulationSubsteps
+int maxSimulationStepsPerFrame = 4; // frame time beyond this is dropped
 
 float windAmount = 0.f;
 float minWindAmount = 0.f;
 float maxWindAmount = 1000.f;
-float windMagnitude = 1.f;
+float windMagnitude = 1.f; // wind speed before the gusts, raised and lowered with UP and DOWN through windAmount
 glm::vec4 windDirection = {0.f, -1.f, 1.f, 0.f};
 glm::vec4 windPosition = {0.f, 0.f, 0.f, 1.f};
+// Animated wind field around the hair (see WindField.h)
+int windFieldResolution = 16; // cells along each side of the box around the hair of all assets
+float windTurbulence = 1.f;   // gust velocity relative to the mean wind
+float gustSize = 2.f;         // world space size of a gust
+const int windFieldTextureUnit = 7;
 
 glm::mat4 model=glm::mat4(1.0f);
 
-
-
-int main()
+// Hair assets (see HairAssets.h): copies of the sphere and its hair in a row along
+// z, moved together by model and simulated by the same dispatches
+int noOfHairAssets = 3;
+float hairAssetSpacing = 6.f;
+// Object space bounds of the strand roots, shared by all assets
+glm::vec3 hairRootLower(0.f);
+glm::vec3 hairRootUpper(0.f);
+
+// Simulation kernel, toggled with C: HairSimulation.comp runs one invocation per strand,
+// HairSimulationCooperative.comp one workgroup per strandsPerWorkGroup strands
+bool useCooperativeKernel = false;
+bool cooperativeKeyPressed = false;
+const int invocationsPerWorkGroup = 64; // cooperative kernel: verticesPerStrand * strands per group
+
+// Sleeping strands (see HairActivity.h), toggled with Z
+bool strandSleeping = true;
+bool sleepingKeyPressed = false;
+float sleepEnergy = 1e-7f;  // kinetic energy per vertex (unit mass) below which a strand is calm
+int sleepSteps = 8;         // calm steps before a strand sleeps, at least HairActivity::minSleepSteps
+float wakeDistance = 1e-3f; // distance of a root from its rest position that wakes the strand
+
+// Simulation level of detail (see HairLod.h), toggled with X
+bool simulationLod = true;
+bool lodKeyPressed = false;
+float pixelsPerGuide = 100.f;        // projected hair area per simulated guide strand
+float lodFadeLevelsPerSecond = 1.f; // how fast levels are blended in and out
+
+// Temporal level of detail (see HairActivity.h), toggled with T: strands whose root
+// is off-screen or farther than these view depths step at half or quarter rate
+bool temporalLod = true;
+bool temporalLodKeyPressed = false;
+float halfRateDistance = 20.f;
+float quarterRateDistance = 40.f;
+
+// Body collisions against the signed distance field of the sphere (see
+// SignedDistanceField.h), toggled with B
+bool bodyCollisions = true;
+bool collisionKeyPressed = false;
+int collisionFieldResolution = 64; // voxels along the longest side
+float collisionFieldPadding = 1.f; // space around the sphere covered by the field
+float collisionMargin = 0.f;       // distance kept from the surface
+const int collisionFieldTextureUnit = 4;
+
+// Hair-hair interaction through a voxel grid (see HairVolume.h), toggled with H
+bool hairInteraction = true;
+bool interactionKeyPressed = false;
+int hairVolumeResolution = 64;  // cells along the longest side of the grid
+float velocitySmoothing = 0.2f;  // share of a vertex velocity replaced by the grid velocity
+float hairRepulsion = 0.05f;     // acceleration per unit of pressure gradient
+float restDensity = 2.f;         // vertices per cell before hair pushes
+const int hairVolumeTextureUnit = 5;
+const int hairPressureGradientTextureUnit = 6;
+
+// Local force fields around the sphere (see HairForceFields.h), toggled with G
+bool forceFields = false;
+bool forceFieldKeyPressed = false;
+
+// Render latency, toggled with O: with one frame of latency a frame draws the hair
+// its predecessor simulated while its own dispatches run (see HairStateBuffers.h)
+HairRenderLatency renderLatency = HAIR_RENDER_ONE_FRAME_LATENCY;
+bool latencyKeyPressed = false;
+
+// Set by toggles that change what acts on resting strands, wakes them all
+bool forcesToggled = false;
+
+
+
+int main(int argc, char** argv)
 {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    std::string recordPath, replayPath;
+    for(int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if(argument == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if(argument == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if(argument == "--frame-time" && i + 1 < argc)
+            fixedFrameTime = (float)atof(argv[++i]);
+        else if(argument == "--headless")
+            headless = true;
+        else if(argument == "--dump" && i + 1 < argc)
+            dumpPrefix = argv[++i];
+        else if(argument == "--dump-interval" && i + 1 < argc)
+            dumpInterval = std::max(atoi(argv[++i]), 1);
+        else if(argument == "--frames" && i + 1 < argc)
+            maxFrames = atoi(argv[++i]);
+        else if(argument == "--duration" && i + 1 < argc)
+            maxDuration = (float)atof(argv[++i]);
+        else if(argument == "--gpu-profile" && i + 1 < argc)
+            gpuProfilePath = argv[++i];
+        else if(argument == "--gpu-profile-interval" && i + 1 < argc)
+            gpuProfileInterval = std::max(atoi(argv[++i]), 1);
+        else if(argument == "--cpu-trace" && i + 1 < argc)
+            cpuTracePath = argv[++i];
+        else if(argument == "--golden-record" && i + 1 < argc)
+            goldenRecordPath = argv[++i];
+        else if(argument == "--golden-check" && i + 1 < argc)
+            goldenCheckPath = argv[++i];
+        else if(argument == "--golden-max" && i + 1 < argc)
+            goldenTolerances.maxDeviation = atof(argv[++i]);
+        else if(argument == "--golden-rms" && i + 1 < argc)
+            goldenTolerances.rmsDeviation = atof(argv[++i]);
+        else if(argument == "--golden-segment" && i + 1 < argc)
+            goldenTolerances.segmentLengthError = atof(argv[++i]);
+        else if(argument == "--storage" && i + 1 < argc && (std::string(argv[i + 1]) == "fp32" || std::string(argv[i + 1]) == "fp16"))
+            hairStorageFormat = std::string(argv[++i]) == "fp16" ? HAIR_STORAGE_FP16 : HAIR_STORAGE_FP32;
+        else {
+            std::cout << "Usage: " << argv[0] << " [--record <file> | --replay <file>] [--frame-time <seconds>]\n"
+                      << "       [--headless [--dump <prefix> [--dump-interval <frames>]]] [--frames <n>] [--duration <seconds>]\n"
+                      << "       [--gpu-profile <file.csv|file.json> [--gpu-profile-interval <frames>]] [--cpu-trace <file.json>]\n"
+                      << "       [--golden-record <file> | --golden-check <file> [--golden-max <distance>] [--golden-rms <distance>]\n"
+                      << "        [--golden-segment <share of the rest length>]] [--storage fp32|fp16]" << std::endl;
+            return -1;
+        }
+    }
+    if(headless && maxFrames <= 0 && maxDuration <= 0.f && replayPath.empty())
+        maxFrames = defaultHeadlessFrames;
+    if((!goldenRecordPath.empty() || !goldenCheckPath.empty()) && !headless)
+        std::cout << "Golden snapshots of a windowed run depend on its frame times, use --headless" << std::endl;
+
+    CpuProfiler::setThreadName("main");
+    if(!cpuTracePath.empty() && CpuProfiler::startTrace(cpuTracePath))
+        std::cout << "Writing CPU trace to " << cpuTracePath << std::endl;
+
+    // A headless run has neither GLFW nor a window, processInput() and the
+    // callbacks see no input
+    GLFWwindow* window = NULL;
+    std::unique_ptr<HeadlessContext> headlessContext;
+    if(headless) {
+        CPU_PROFILE_ZONE("context creation");
+        headlessContext.reset(new HeadlessContext());
+        if(!headlessContext->isValid())
+            return -1;
+    }
+    else {
+        CPU_PROFILE_ZONE("context creation");
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SAMPLES, 4);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw  creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Hair simulation", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        // glfw  creation
+        // --------------------
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Hair simulation", NULL, NULL);
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        // set callback functions
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+
+        // tell GLFW to capture our mouse
+        // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
-    glfwMakeContextCurrent(window);
-    // set callback functions
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // tell GLFW to capture our mouse
-    // glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // configure global opengl state
     // -----------------------------
@@ -106,65 +325,330 @@ int main()
     // Set this to true so GLEW knows to use a modern approach to retrieving function pointers and extensions
     glewExperimental = GL_TRUE;
 
-    // Initialize GLEW to setup the OpenGL Function pointers
-    if (glewInit() != GLEW_OK) {
+    // Initialize GLEW to setup the OpenGL Function pointers. GLEW built for GLX
+    // reports the missing X display of a headless context after it loaded them.
+    GLenum glewStatus;
+    {
+        CPU_PROFILE_ZONE("glewInit");
+        glewStatus = glewInit();
+    }
+    if (glewStatus != GLEW_OK && !(headlessContext && glDispatchCompute)) {
         std::cout << "Failed to initialize GLEW" << std::endl;
         return -1;
     }
+    if(headlessContext)
+        headlessContext->createFramebuffer(WIDTH, HEIGHT, 4);
 
     // create model
     // -----------------------------
     Sphere sphere(2.0, 40);
 
+    std::unique_ptr<SignedDistanceField> collisionField;
+    {
+        CPU_PROFILE_ZONE("collision field bake");
+        StrandScheduler bakeScheduler;
+        collisionField.reset(new SignedDistanceField(sphere.getVertexArray(), 8, sphere.getIndexArray(), sphere.getNoOfTriangles(),
+                                                     collisionFieldResolution, collisionFieldPadding, bakeScheduler));
+        glm::ivec3 fieldResolution = collisionField->getResolution();
+        std::cout << "Collision field: " << fieldResolution.x << "x" << fieldResolution.y << "x" << fieldResolution.z
+                  << " baked in " << collisionField->getBakeSeconds() * 1000.0 << " ms on "
+                  << bakeScheduler.getNoOfWorkers() << " threads" << std::endl;
+    }
+
+    WindField windField(windFieldResolution);
+
+    // a fan under the sphere, a whirl on top, turbulence, drag and an attractor at the sides
+    HairForceFields hairForceFields;
+    hairForceFields.add(HairForceFields::directional(glm::vec3(0.f, -2.5f, 0.f), 1.5f, glm::vec3(0.f, 1.f, 0.f), 15.f));
+    hairForceFields.add(HairForceFields::vortex(glm::vec3(0.f, 2.f, 0.f), 1.f, glm::vec3(0.f, 1.f, 0.f), 5.f));
+    hairForceFields.add(HairForceFields::turbulence(glm::vec3(2.f, 0.f, 0.f), 1.5f, 5.f, 4.f));
+    hairForceFields.add(HairForceFields::drag(glm::vec3(-2.f, 0.f, 0.f), 1.5f, 5.f));
+    hairForceFields.add(HairForceFields::point(glm::vec3(0.f, 0.f, 2.5f), 1.5f, -5.f, 2.f));
+
     TextureData mainTexture;
-    LoadTGATexture("../textures/brown.tga", &mainTexture);
+    {
+        // LoadTGA.c is C, the zone is kept at the call
+        CPU_PROFILE_ZONE_DETAIL("LoadTGATexture", "brown.tga");
+        LoadTGATexture("../textures/brown.tga", &mainTexture);
+    }
     // Hair
     // ---------------------------------------------------------------------------------
 
-    // Creation of the master hairs
-    GLfloat* hairData = createMasterHairs(sphere);
-
-    // Generation of textures for hair data
-    GLuint hairDataTextureID_rest = generateTextureFromHairData(hairData);
-    GLuint hairDataTextureID_last = generateTextureFromHairData(hairData);
-    GLuint hairDataTextureID_current = generateTextureFromHairData(hairData);
-    GLuint hairDataTextureID_simulated = generateTextureFromHairData(NULL);
-
+    // The hair state and the shader variants depend on verticesPerStrand and are
+    // rebuilt when it is switched at runtime
+    std::unique_ptr<HairAssets> hairAssets;
+    std::unique_ptr<HairStateBuffers> hairState;
+    std::unique_ptr<HairActivity> hairActivity;
+    std::unique_ptr<HairLod> hairLod;
+    std::unique_ptr<HairVolume> hairVolume;
+    ShaderVariantCache shaderVariants;
+    Shader* hairShader = nullptr;
+    ComputeShader* computeShader = nullptr;
+    ComputeShader* cooperativeComputeShader = nullptr;
+    ComputeShader* activityShader = nullptr;
+    ComputeShader* lodInterpolationShader = nullptr;
+    ComputeShader* extrapolationShader = nullptr;
+    ComputeShader* volumeSplatShader = nullptr;
+    ComputeShader* volumeResolveShader = nullptr;
+    ComputeShader& windShader = shaderVariants.getComputeShader("../shaders/HairWind.comp", "");
+    resolutionChanged = true;
 
     // build and compile our shader program
     // ------------------------------------
-    Shader hairShader("../shaders/Hair.vert","../shaders/Hair.frag", "../shaders/Hair.geom",
-                               "../shaders/Hair.tesc", "../shaders/Hair.tese");
     Shader shader("../shaders/shader.vert","../shaders/shader.frag");
-    ComputeShader computeShader("../shaders/HairSimulation.comp");
-    shader.use();
-    hairShader.use();
-    computeShader.use();
 
     // uniform variables
     // be sure to activate shader when setting uniforms/drawing objects
     shader.use();
     shader.setInt("mainTexture", 0);
 
-    hairShader.use();
-    hairShader.setInt("mainTexture", 0);
-    hairShader.setInt("hairDataTexture", 1);
-    hairShader.setInt("randomDataTexture", 2);
+    SimulationClock simulationClock(timeStep, simulationSubsteps, maxSimulationStepsPerFrame);
+    bool wakeAllStrands = false;
+    int simulationStep = 0; // staggers the strands of the temporal level of detail
+
+    // Placement of the assets and interpolation factor of the state the next
+    // one frame latent draw renders
+    std::vector<glm::mat4> renderModelMatrices;
+    float renderInterpolation = 0.f;
+    // frames and their time since the render latency was switched
+    int latencyFrames = 0;
+    float latencySeconds = 0.f;
+
+    // Stages of the frame on the GPU, a stage that runs per substep sums its runs
+    GpuProfiler gpuProfiler;
+    const int gpuFrame = gpuProfiler.addStage("frame");
+    const int gpuWindField = gpuProfiler.addStage("wind field");
+    const int gpuHairVolume = gpuProfiler.addStage("hair volume");
+    const int gpuClassification = gpuProfiler.addStage("classification");
+    const int gpuSimulation = gpuProfiler.addStage("simulation");
+    const int gpuExtrapolation = gpuProfiler.addStage("extrapolation");
+    const int gpuLodInterpolation = gpuProfiler.addStage("lod interpolation");
+    const int gpuSphereDraw = gpuProfiler.addStage("sphere draw");
+    const int gpuHairDraw = gpuProfiler.addStage("hair draw");
+    PipelineStatistics hairDrawStatistics;
+    // GL_TIMESTAMP counts on the GPU clock, shifted once onto the clock of the CPU trace
+    if(CpuProfiler::isEnabled()) {
+        GLint64 gpuTime = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        int64_t gpuClockOffset = (int64_t)CpuProfiler::now() - gpuTime;
+        gpuProfiler.setRunCallback([&gpuProfiler, gpuClockOffset](int stage, GLuint64 begin, GLuint64 end) {
+            CpuProfiler::addGpuZone(gpuProfiler.getStageName(stage), begin + gpuClockOffset, end + gpuClockOffset);
+        });
+    }
+    bool gpuProfileJson = gpuProfilePath.size() >= 5 && gpuProfilePath.compare(gpuProfilePath.size() - 5, 5, ".json") == 0;
+    std::ofstream gpuProfileCsv;
+    if(!gpuProfilePath.empty() && !gpuProfileJson) {
+        gpuProfileCsv.open(gpuProfilePath);
+        if(!gpuProfileCsv)
+            std::cout << "Failed to open GPU profile " << gpuProfilePath << std::endl;
+    }
+    auto writeGpuProfile = [&]() {
+        if(gpuProfileJson) {
+            std::ofstream json(gpuProfilePath);
+            gpuProfiler.writeJson(json);
+        }
+        else if(gpuProfileCsv)
+            gpuProfiler.writeCsv(gpuProfileCsv, gpuProfileCsv.tellp() == 0);
+    };
+
+    // Draws the spheres and the hair of all assets with the given placements
+    auto renderScene = [&](const std::vector<glm::mat4>& modelMatrices, float interpolation,
+                           const glm::mat4& view, const glm::mat4& projection) {
+        CPU_PROFILE_ZONE("render scene");
+        // render object ( sphere or any other object)
+        shader.use();
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+        glActiveTexture(GL_TEXTURE0 + 0);
+        glBindTexture(GL_TEXTURE_2D, mainTexture.texID);
+        gpuProfiler.begin(gpuSphereDraw);
+        for(const glm::mat4& modelMatrix : modelMatrices) {
+            shader.setMat4("model", modelMatrix);
+            sphere.draw(GL_TRIANGLES);
+        }
+        gpuProfiler.end(gpuSphereDraw);
+
+        //render hair
+        hairShader->use();
+        hairShader->setMat4("projection", projection);
+        hairShader->setMat4("view", view);
+        hairShader->setVec3("lightPos", lightPos.x, lightPos.y, lightPos.z);
+        hairShader->setVec3("lightColor", lightColor.x, lightColor.y, lightColor.z);
+        hairShader->setVec3("cameraPosition", camera.Position.x, camera.Position.y, camera.Position.z);
+        hairShader->setFloat("noOfVertices", (float)noOfMasterHairs);
+        hairShader->setFloat("dataVariablesPerMasterHair", (float)dataVariablesPerMasterHair);
+        hairShader->setFloat("renderInterpolation", interpolation);
+
+        // Main texture (for color)
+        glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
+        glBindTexture(GL_TEXTURE_2D, mainTexture.texID);
 
+        // Hair data saved in texture: current positions on unit 1, pinned positions on unit 3
+        hairState->bindForRendering(1, 3);
+
+        // one draw per asset, over its strands in the packed state
+        gpuProfiler.begin(gpuHairDraw);
+        hairDrawStatistics.begin();
+        for(size_t asset = 0; asset < modelMatrices.size(); asset++) {
+            hairShader->setMat4("model", modelMatrices[asset]);
+            hairShader->setInt("firstStrand", hairAssets->getParameters((int)asset).firstStrand);
+            sphere.draw(GL_PATCHES);
+        }
+        hairDrawStatistics.end();
+        gpuProfiler.end(gpuHairDraw);
+    };
 
-    computeShader.use();
     float rotationAngle = 0.f;
-    while (!glfwWindowShouldClose(window))
+    if(!replayPath.empty()) {
+        if(inputRecorder.startReplay(replayPath, fixedFrameTime))
+            std::cout << "Replaying " << replayPath << " at " << fixedFrameTime * 1000.f << " ms per frame" << std::endl;
+    }
+    else if(!recordPath.empty() && inputRecorder.startRecording(recordPath))
+        std::cout << "Recording input to " << recordPath << std::endl;
+    // nothing to measure a headless frame by, it lasts the fixed frame time
+    if(headless)
+        inputRecorder.setFrameTime(fixedFrameTime);
+    double runStart = getWallSeconds();
+    double lastWallTime = runStart;
+    int frameCount = 0;
+
+    while (!(window && glfwWindowShouldClose(window)))
     {
+        if((maxFrames > 0 && frameCount >= maxFrames) ||
+           (maxDuration > 0.f && getWallSeconds() - runStart >= maxDuration))
+            break;
+
+        // the zones of the last frame go to the trace
+        {
+            CPU_PROFILE_ZONE("trace flush");
+            CpuProfiler::flush();
+        }
+        CPU_PROFILE_ZONE("frame");
+
         // per-frame time logic
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        double wallTime = getWallSeconds();
+        float frameWallSeconds = float(wallTime - lastWallTime);
+        lastWallTime = wallTime;
+        deltaTime = inputRecorder.beginFrame(wallTime);
+        if(inputRecorder.isFinished())
+            break;
+        float currentFrame = (float)inputRecorder.getTime();
 
         // input
         // -----
-        processInput(window);
+        {
+            CPU_PROFILE_ZONE("input");
+            for(const InputEvent& event : inputRecorder.getFrameEvents()) {
+                if(event.type == INPUT_CURSOR)
+                    moveCursor(event.x, event.y);
+                else if(event.type == INPUT_SCROLL)
+                    scroll(event.y);
+            }
+            processInput(window);
+        }
+        InputParameters inputParameters = {camera.Position, camera.Zoom, model, windAmount, hairStrandLength};
+        inputRecorder.endInput(inputParameters);
+        camera.Position = inputParameters.cameraPosition;
+        camera.Zoom = inputParameters.cameraZoom;
+        model = inputParameters.model;
+        windAmount = inputParameters.windAmount;
+        hairStrandLength = inputParameters.hairStrandLength;
+
+        if(resolutionChanged) {
+            CPU_PROFILE_ZONE("hair rebuild");
+            // Creation of the master hairs, packed for all assets, and of the shader
+            // storage buffers for hair data
+            GLfloat* groomData = createMasterHairs(sphere);
+            hairRootLower = hairRootUpper = glm::vec3(groomData[0], groomData[1], groomData[2]);
+            for(int strand = 1; strand < noOfMasterHairs; strand++) {
+                const GLfloat* root = groomData + (size_t)strand * verticesPerStrand * 4;
+                hairRootLower = glm::min(hairRootLower, glm::vec3(root[0], root[1], root[2]));
+                hairRootUpper = glm::max(hairRootUpper, glm::vec3(root[0], root[1], root[2]));
+            }
+            hairAssets.reset(new HairAssets());
+            for(int asset = 0; asset < noOfHairAssets; asset++) {
+                // the neighbours of the first asset respond differently to the wind
+                HairAssetParameters parameters;
+                parameters.modelMatrix = getAssetModelMatrix(asset);
+                parameters.windResponse = asset == 0 ? 1.f : (asset % 2 == 1 ? 2.f : 0.5f);
+                parameters.globalStiffness = asset == 0 ? 0.8f : (asset % 2 == 1 ? 0.6f : 0.9f);
+                parameters.lengthConstraintMode = asset == 0 ? lengthConstraintMode : HAIR_LENGTH_ITERATIVE;
+                parameters.ftlDamping = ftlDamping;
+                hairAssets->add(noOfMasterHairs, parameters);
+            }
+            int noOfStrands = hairAssets->getNoOfStrands();
+            size_t groomSize = (size_t)noOfMasterHairs * verticesPerStrand * 4;
+            std::vector<GLfloat> hairData(groomSize * noOfHairAssets);
+            for(int asset = 0; asset < noOfHairAssets; asset++)
+                std::copy(groomData, groomData + groomSize, hairData.begin() + asset * groomSize);
+            delete[] groomData;
+
+            hairState.reset(new HairStateBuffers(hairData.data(), noOfStrands, verticesPerStrand, hairStorageFormat,
+                                                 hairAssets.get()));
+            hairState->printMemoryReport(std::cout);
+            hairActivity.reset(new HairActivity(noOfStrands));
+            hairLod.reset(new HairLod(hairData.data(), *hairAssets, verticesPerStrand));
+            std::cout << "Simulation LOD: " << hairLod->getNoOfLevels() << " levels" << std::endl;
+            // the grid reaches a strand length beyond the rest pose
+            hairVolume.reset(new HairVolume(hairData.data(), noOfStrands, verticesPerStrand, hairVolumeResolution,
+                                            verticesPerStrand * hairStrandLength, noOfHairAssets));
+
+            // Shader variants specialised for this resolution, compiled on first use
+            std::string hairDefines = getHairShaderDefines();
+            hairShader = &shaderVariants.getShader("../shaders/Hair.vert", "../shaders/Hair.frag", "../shaders/Hair.geom",
+                                                   "../shaders/Hair.tesc", "../shaders/Hair.tese", hairDefines);
+            computeShader = &shaderVariants.getComputeShader("../shaders/HairSimulation.comp", hairDefines);
+            cooperativeComputeShader = &shaderVariants.getComputeShader("../shaders/HairSimulationCooperative.comp",
+                ShaderDefines().append(hairDefines).define("STRANDS_PER_GROUP", getStrandsPerWorkGroup()).str());
+            activityShader = &shaderVariants.getComputeShader("../shaders/HairActivity.comp", hairDefines);
+            lodInterpolationShader = &shaderVariants.getComputeShader("../shaders/HairLodInterpolation.comp", hairDefines);
+            extrapolationShader = &shaderVariants.getComputeShader("../shaders/HairExtrapolation.comp", hairDefines);
+            volumeSplatShader = &shaderVariants.getComputeShader("../shaders/HairVolumeSplat.comp", hairDefines);
+            volumeResolveShader = &shaderVariants.getComputeShader("../shaders/HairVolumeResolve.comp", hairDefines);
+
+            for(ComputeShader* simulationShader : {computeShader, cooperativeComputeShader}) {
+                simulationShader->use();
+                simulationShader->setInt("collisionField", collisionFieldTextureUnit);
+                simulationShader->setInt("hairVolume", hairVolumeTextureUnit);
+                simulationShader->setInt("hairPressureGradient", hairPressureGradientTextureUnit);
+                simulationShader->setInt("windField", windFieldTextureUnit);
+            }
+            activityShader->use();
+            activityShader->setInt("windField", windFieldTextureUnit);
+
+            hairShader->use();
+            hairShader->setInt("mainTexture", 0);
+            hairShader->setInt("hairDataTexture", 1);
+            hairShader->setInt("randomDataTexture", 2);
+            hairShader->setInt("pinnedHairDataTexture", 3);
+            // nothing presented by the new state yet, it starts without latency
+            renderModelMatrices.clear();
+            latencyFrames = 0;
+            latencySeconds = 0.f;
+            resolutionChanged = false;
+        }
+
+        // report the mode that is switched off, frame time against the latency it adds
+        if(renderLatency != hairState->getRenderLatency()) {
+            if(latencyFrames > 0) {
+                std::cout << "Render latency " << (hairState->getRenderLatency() == HAIR_RENDER_ONE_FRAME_LATENCY ? "one frame" : "zero")
+                          << ": " << 1000.0 * latencySeconds / latencyFrames << " ms per frame over " << latencyFrames
+                          << " frames" << std::endl;
+            }
+            hairState->setRenderLatency(renderLatency);
+            renderModelMatrices.clear();
+            latencyFrames = 0;
+            latencySeconds = 0.f;
+        }
+        latencyFrames++;
+        latencySeconds += frameWallSeconds;
+
+        {
+            CPU_PROFILE_ZONE("gpu profile readback");
+            gpuProfiler.beginFrame();
+        }
+        gpuProfiler.begin(gpuFrame);
 
         // render
         // ------
@@ -175,115 +659,383 @@ int main()
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 100000.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        
-    
+
+        // One frame of latency: the hair the last frame simulated is drawn first, at
+        // the placement it was simulated with, and this frame's dispatches follow
+        // without a barrier between them and the draw
+        bool latentRender = renderLatency == HAIR_RENDER_ONE_FRAME_LATENCY && !renderModelMatrices.empty();
+        if(latentRender)
+            renderScene(renderModelMatrices, renderInterpolation, view, projection);
+
         // simulation of hair
         // -------------------------------------------------------------------
-        windMagnitude *= (pow(sin(currentFrame * 0.05), 2) + 0.5);
-
-        computeShader.use();
-        glBindImageTexture(0, hairDataTextureID_rest, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-        glBindImageTexture(1, hairDataTextureID_last, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-        glBindImageTexture(2, hairDataTextureID_current, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-        glBindImageTexture(3, hairDataTextureID_simulated, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-        computeShader.setMat4("modelMatrix", model);
-        computeShader.setFloat("damping", damping);
-        computeShader.setFloat("timeStep", timeStep);
-        computeShader.setInt("verticesPerStrand", verticesPerStrand);
-        computeShader.setFloat("hairStrandLength", hairStrandLength);
-        computeShader.setFloat("windMagnitude", windMagnitude + windAmount);
-        computeShader.setVec4("windDirection", windDirection.x, windDirection.y, windDirection.z, windDirection.w);
-        glDispatchCompute(1, noOfMasterHairs, 1); // Call for each master hair strand
+        // gusts around the wind speed, not compounded from frame to frame
+        float windGust = (windMagnitude + windAmount) * (pow(sin(currentFrame * 0.05), 2) + 0.5);
+
+        HairSolverParameters forces;
+        forces.timeStep = simulationClock.getSubstepSeconds();
+        forces.damping = damping;
+        forces.hairStrandLength = hairStrandLength;
+        forces.windMagnitude = windGust;
+        forces.windDirection = windDirection;
+        // a change wakes all strands at the next dispatch, which may be frames away
+        if(hairActivity->forcesChanged(forces) || forcesToggled)
+            wakeAllStrands = true;
+        forcesToggled = false;
+
+        // the per asset uniforms of a single object, uploaded as one table. The
+        // follow-the-leader correction and the temporal level of detail move the
+        // history away from the current positions.
+        bool correctsHistory = temporalLod;
+        for(int asset = 0; asset < hairAssets->getNoOfAssets(); asset++) {
+            HairAssetParameters& parameters = hairAssets->getParameters(asset);
+            parameters.modelMatrix = getAssetModelMatrix(asset);
+            parameters.damping = damping;
+            parameters.hairStrandLength = hairStrandLength;
+            if(asset == 0)
+                parameters.lengthConstraintMode = lengthConstraintMode;
+            correctsHistory = correctsHistory || parameters.lengthConstraintMode == HAIR_LENGTH_FTL;
+        }
+        hairAssets->bind();
+
+        {
+            CPU_PROFILE_ZONE("lod update");
+            if(simulationLod)
+                hairLod->update(*hairAssets, view, projection, (float)HEIGHT, pixelsPerGuide, lodFadeLevelsPerSecond, deltaTime);
+            else
+                hairLod->simulateAll();
+        }
+        hairLod->bindBuffers();
+
+        activityShader->use();
+        activityShader->setInt("simulatedStrands", hairLod->getSimulatedStrands());
+        activityShader->setInt("fadingRank", hairLod->getFadingRank());
+        activityShader->setInt("noOfMasterHairs", hairAssets->getNoOfStrands());
+        activityShader->setInt("strandsPerGroup", getStrandsPerWorkGroup());
+        activityShader->setFloat("sleepEnergy", sleepEnergy);
+        activityShader->setInt("sleepSteps", std::max(sleepSteps, HairActivity::minSleepSteps));
+        activityShader->setFloat("wakeDistance", wakeDistance);
+        activityShader->setBool("temporalLod", temporalLod);
+        activityShader->setMat4("viewProjection", projection * view);
+        activityShader->setFloat("halfRateDistance", halfRateDistance);
+        activityShader->setFloat("quarterRateDistance", quarterRateDistance);
+        activityShader->setInt("noOfForceFields", forceFields ? hairForceFields.getNoOfFields() : 0);
+        activityShader->setFloat("timeStep", simulationClock.getSubstepSeconds());
+        hairForceFields.bind(hairStrandLength * (verticesPerStrand - 1));
+
+        // wind around the hair of all assets at the simulated time of the first
+        // dispatch of this frame
+        gpuProfiler.begin(gpuWindField);
+        glm::vec3 hairLower, hairUpper;
+        getHairBounds(hairLower, hairUpper);
+        windShader.use();
+        windShader.setFloat("turbulence", windTurbulence);
+        windShader.setFloat("gustSize", gustSize);
+        windField.dispatchUpdate(windShader, hairLower, hairUpper, windGust * getUniformWind(windDirection),
+                                 simulationStep * simulationClock.getSubstepSeconds());
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        gpuProfiler.end(gpuWindField);
+        // the classification wakes the strands a change of the wind reaches
+        activityShader->use();
+        activityShader->setMat4("windFieldMatrix", windField.getTextureMatrix());
+
+        ComputeShader& simulationShader = useCooperativeKernel ? *cooperativeComputeShader : *computeShader;
+        simulationShader.use();
+        simulationShader.setFloat("timeStep", simulationClock.getSubstepSeconds());
+        simulationShader.setMat4("windFieldMatrix", windField.getTextureMatrix());
+        windField.bind(windFieldTextureUnit);
+        simulationShader.setBool("writeHistory", correctsHistory);
+        simulationShader.setBool("collisions", bodyCollisions);
+        simulationShader.setMat4("collisionMatrix", collisionField->getTextureMatrix());
+        simulationShader.setFloat("collisionMargin", collisionMargin);
+        collisionField->bind(collisionFieldTextureUnit);
+        simulationShader.setBool("hairInteraction", hairInteraction);
+        simulationShader.setMat4("hairVolumeMatrix", hairVolume->getTextureMatrix());
+        simulationShader.setInt("hairVolumeSlabs", hairVolume->getNoOfSlabs());
+        simulationShader.setFloat("velocitySmoothing", velocitySmoothing);
+        simulationShader.setFloat("hairRepulsion", hairRepulsion);
+        hairVolume->bindForSimulation(hairVolumeTextureUnit, hairPressureGradientTextureUnit);
+        simulationShader.setInt("noOfForceFields", forceFields ? hairForceFields.getNoOfFields() : 0);
+
+        int simulationSteps = simulationClock.advance(deltaTime);
+        {
+            CPU_PROFILE_ZONE("simulation dispatch");
+            for(int step = 0; step < simulationSteps; step++) {
+                hairState->pinRenderState(); // rendering interpolates from here to the end of the step
+                for(int substep = 0; substep < simulationClock.getSubsteps(); substep++) {
+                    hairState->bindForSimulation(correctsHistory);
+
+                    // density and velocity of all vertices in the interaction grid
+                    if(hairInteraction) {
+                        gpuProfiler.begin(gpuHairVolume);
+                        hairVolume->dispatchSplat(*volumeSplatShader);
+                        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                        hairVolume->dispatchResolve(*volumeResolveShader, restDensity);
+                        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+                        gpuProfiler.end(gpuHairVolume);
+                    }
+
+                    // list the strands that are awake
+                    gpuProfiler.begin(gpuClassification);
+                    activityShader->use();
+                    activityShader->setBool("wakeAll", wakeAllStrands || !strandSleeping);
+                    activityShader->setInt("simulationStep", simulationStep++);
+                    hairActivity->bindForClassification();
+                    hairActivity->dispatchClassification();
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+                    gpuProfiler.end(gpuClassification);
+                    wakeAllStrands = false;
+
+                    // Call for each awake master hair strand, or group of them with the cooperative kernel
+                    gpuProfiler.begin(gpuSimulation);
+                    simulationShader.use();
+                    simulationShader.setFloat("fieldTime", simulationStep * simulationClock.getSubstepSeconds());
+                    hairActivity->dispatchSimulation(useCooperativeKernel);
+                    gpuProfiler.end(gpuSimulation);
+
+                    // strands that skip this step keep moving
+                    gpuProfiler.begin(gpuExtrapolation);
+                    extrapolationShader->use();
+                    hairActivity->dispatchExtrapolation();
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                    gpuProfiler.end(gpuExtrapolation);
+
+                    // strands the level of detail does not simulate follow their parents
+                    gpuProfiler.begin(gpuLodInterpolation);
+                    hairLod->dispatchInterpolation(*lodInterpolationShader);
+                    gpuProfiler.end(gpuLodInterpolation);
+                    hairState->swapBuffers(); // the new positions become current, nothing is copied
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT); // the next dispatch reads them
+                }
+            }
+        }
+
+        // the state the next one frame latent draw renders
+        hairState->presentRenderState();
+        renderModelMatrices.clear();
+        for(int asset = 0; asset < hairAssets->getNoOfAssets(); asset++)
+            renderModelMatrices.push_back(hairAssets->getParameters(asset).modelMatrix);
+        renderInterpolation = simulationClock.getInterpolation();
 
         // rendering
         // -------------------------------------------------------------------
+        if(!latentRender) {
+            // Wait until simulation is finished
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            renderScene(renderModelMatrices, renderInterpolation, view, projection);
+        }
+        gpuProfiler.end(gpuFrame);
+        gpuProfiler.endFrame();
 
-        // render object ( sphere or any other object)
-        shader.use();
-        shader.setMat4("model", model);
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-        glActiveTexture(GL_TEXTURE0 + 0);
-        glBindTexture(GL_TEXTURE_2D, mainTexture.texID);
-        sphere.draw(GL_TRIANGLES);
-
-        // Wait until simulation is finished
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        //render hair
-        hairShader.use();
-        hairShader.setMat4("model", model);
-        hairShader.setMat4("projection", projection);
-        hairShader.setMat4("view", view);
-        hairShader.setVec3("lightPos", lightPos.x, lightPos.y, lightPos.z);
-        hairShader.setVec3("lightColor", lightColor.x, lightColor.y, lightColor.z);
-        hairShader.setVec3("cameraPosition", camera.Position.x, camera.Position.y, camera.Position.z);
-        hairShader.setFloat("verticesPerStrand", (float)verticesPerStrand);
-        hairShader.setFloat("noOfVertices", (float)noOfMasterHairs);
-        hairShader.setFloat("dataVariablesPerMasterHair", (float)dataVariablesPerMasterHair);
-
-        // Main texture (for color)
-        glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
-        glBindTexture(GL_TEXTURE_2D, mainTexture.texID);
-
-        // Hair data saved in texture
-        glActiveTexture(GL_TEXTURE0 + 1); // Texture unit 1
-        glBindTexture(GL_TEXTURE_2D, hairDataTextureID_simulated);
-
-        sphere.draw(GL_PATCHES);
+        if(printGpuProfile) {
+            gpuProfiler.print(std::cout);
+            hairDrawStatistics.print(std::cout, hairAssets->getNoOfStrands(), verticesPerStrand);
+        }
+        printGpuProfile = false;
+        if(!gpuProfilePath.empty() && (frameCount + 1) % gpuProfileInterval == 0)
+            writeGpuProfile();
+
+        if(headlessContext) {
+            CPU_PROFILE_ZONE("present");
+            if(!dumpPrefix.empty() && frameCount % dumpInterval == 0) {
+                char filename[32];
+                snprintf(filename, sizeof(filename), "%05d.tga", frameCount);
+                headlessContext->saveFrame((dumpPrefix + filename).c_str());
+            }
+            glFlush();
+        }
+        else {
+            CPU_PROFILE_ZONE("present");
+            // Swap front and back buffers
+            glfwSwapBuffers(window);
 
-        glCopyImageSubData(hairDataTextureID_current, GL_TEXTURE_2D, 0, 0, 0, 0,
-                           hairDataTextureID_last, GL_TEXTURE_2D, 0, 0, 0, 0,
-                           verticesPerStrand, noOfMasterHairs, 1);
+            glfwPollEvents();
+        }
+        frameCount++;
+    }
 
-        glCopyImageSubData(hairDataTextureID_simulated, GL_TEXTURE_2D, 0, 0, 0, 0,
-                           hairDataTextureID_current, GL_TEXTURE_2D, 0, 0, 0, 0,
-                           verticesPerStrand, noOfMasterHairs, 1);
+    if(!gpuProfilePath.empty())
+        writeGpuProfile();
+    CpuProfiler::stopTrace();
+    if(headless) {
+        gpuProfiler.print(std::cout);
+        hairDrawStatistics.print(std::cout, hairAssets->getNoOfStrands(), verticesPerStrand);
+    }
 
-        // Swap front and back buffers
-        glfwSwapBuffers(window);
+    if(inputRecorder.getMode() == INPUT_REPLAY || headless) {
+        double runSeconds = getWallSeconds() - runStart;
+        std::cout << (inputRecorder.getMode() == INPUT_REPLAY ? "Replayed " : "Ran ") << frameCount << " frames in "
+                  << runSeconds << " s, " << 1000.0 * runSeconds / std::max(frameCount, 1) << " ms per frame" << std::endl;
+    }
 
-        glfwPollEvents();
+    // the state after the last frame against the golden one
+    int exitCode = 0;
+    if(hairState && (!goldenRecordPath.empty() || !goldenCheckPath.empty())) {
+        HairSnapshot snapshot(hairAssets->getNoOfStrands(), verticesPerStrand, hairStrandLength, frameCount);
+        hairState->getPositions(snapshot.getPositions());
+        if(!goldenRecordPath.empty()) {
+            if(snapshot.save(goldenRecordPath))
+                std::cout << "Golden snapshot after " << frameCount << " frames written to " << goldenRecordPath << std::endl;
+            else
+                exitCode = 1;
+        }
+        if(!goldenCheckPath.empty()) {
+            HairSnapshot golden;
+            HairSnapshotComparison comparison;
+            if(golden.load(goldenCheckPath)) {
+                if(golden.getSteps() != frameCount)
+                    std::cout << "Golden snapshot was taken after " << golden.getSteps() << " frames, this run ran "
+                              << frameCount << std::endl;
+                comparison = golden.compare(snapshot, goldenTolerances);
+                HairSnapshot::printComparison(std::cout, std::string("gpu ") + HairStateBuffers::getName(hairStorageFormat),
+                                              comparison, goldenTolerances);
+            }
+            if(!comparison.passed)
+                exitCode = 1;
+        }
     }
 
     // Terminate GLFW, clearing any resources allocated by GLFW.
-    glfwTerminate();
-    return 0;
+    if(window)
+        glfwTerminate();
+    return exitCode;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
 { 
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (window && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_W))
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_S))
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_A))
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_D))
         camera.ProcessKeyboard(RIGHT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_L))
         model = glm::translate(model, glm::vec3(0.05f, 0.f, 0.f));
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_J))
         model = glm::translate(model, glm::vec3(-0.05f, 0.f, 0.f));
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_K))
         model = glm::translate(model, glm::vec3(0.f, -0.05f, 0.f));
-    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_I))
         model = glm::translate(model, glm::vec3(0.f, 0.05f, 0.f));
-    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_RIGHT))
             hairStrandLength += 0.005;
-    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_LEFT))
             hairStrandLength += 0.005;
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_UP))
         if(windAmount < maxWindAmount)
             windAmount += 10.f;
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+    if (inputRecorder.isKeyDown(window, GLFW_KEY_DOWN))
         if(windAmount > minWindAmount)
             windAmount -= 10.f;
+
+    // switch simulation kernel once per key press
+    bool cooperativeKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_C);
+    if (cooperativeKeyDown && !cooperativeKeyPressed) {
+        useCooperativeKernel = !useCooperativeKernel;
+        std::cout << "Simulation kernel: " << (useCooperativeKernel ? "cooperative" : "single thread per strand") << std::endl;
+    }
+    cooperativeKeyPressed = cooperativeKeyDown;
+
+    // switch sleeping strands once per key press
+    bool sleepingKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_Z);
+    if (sleepingKeyDown && !sleepingKeyPressed) {
+        strandSleeping = !strandSleeping;
+        std::cout << "Sleeping strands: " << (strandSleeping ? "on" : "off") << std::endl;
+    }
+    sleepingKeyPressed = sleepingKeyDown;
+
+    // switch simulation level of detail once per key press
+    bool lodKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_X);
+    if (lodKeyDown && !lodKeyPressed) {
+        simulationLod = !simulationLod;
+        std::cout << "Simulation LOD: " << (simulationLod ? "on" : "off") << std::endl;
+    }
+    lodKeyPressed = lodKeyDown;
+
+    // switch temporal level of detail once per key press
+    bool temporalLodKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_T);
+    if (temporalLodKeyDown && !temporalLodKeyPressed) {
+        temporalLod = !temporalLod;
+        std::cout << "Temporal LOD: " << (temporalLod ? "on" : "off") << std::endl;
+    }
+    temporalLodKeyPressed = temporalLodKeyDown;
+
+    // switch body collisions once per key press
+    bool collisionKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_B);
+    if (collisionKeyDown && !collisionKeyPressed) {
+        bodyCollisions = !bodyCollisions;
+        forcesToggled = true;
+        std::cout << "Body collisions: " << (bodyCollisions ? "on" : "off") << std::endl;
+    }
+    collisionKeyPressed = collisionKeyDown;
+
+    // switch hair-hair interaction once per key press
+    bool interactionKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_H);
+    if (interactionKeyDown && !interactionKeyPressed) {
+        hairInteraction = !hairInteraction;
+        forcesToggled = true;
+        std::cout << "Hair-hair interaction: " << (hairInteraction ? "on" : "off") << std::endl;
+    }
+    interactionKeyPressed = interactionKeyDown;
+
+    // switch the force fields once per key press
+    bool forceFieldKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_G);
+    if (forceFieldKeyDown && !forceFieldKeyPressed) {
+        forceFields = !forceFields;
+        forcesToggled = true;
+        std::cout << "Force fields: " << (forceFields ? "on" : "off") << std::endl;
+    }
+    forceFieldKeyPressed = forceFieldKeyDown;
+
+    // switch to the next strand resolution once per key press
+    bool resolutionKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_V);
+    if (resolutionKeyDown && !resolutionKeyPressed) {
+        const int noOfResolutions = sizeof(supportedVerticesPerStrand) / sizeof(supportedVerticesPerStrand[0]);
+        const int* next = std::upper_bound(supportedVerticesPerStrand, supportedVerticesPerStrand + noOfResolutions, verticesPerStrand);
+        verticesPerStrand = next == supportedVerticesPerStrand + noOfResolutions ? supportedVerticesPerStrand[0] : *next;
+        resolutionChanged = true;
+        std::cout << "Vertices per strand: " << verticesPerStrand << std::endl;
+    }
+    resolutionKeyPressed = resolutionKeyDown;
+
+    // switch the precision of the hair state once per key press, which rebuilds it
+    bool storageKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_M);
+    if (storageKeyDown && !storageKeyPressed) {
+        hairStorageFormat = hairStorageFormat == HAIR_STORAGE_FP16 ? HAIR_STORAGE_FP32 : HAIR_STORAGE_FP16;
+        resolutionChanged = true;
+        std::cout << "Hair state storage: " << HairStateBuffers::getName(hairStorageFormat) << std::endl;
+    }
+    storageKeyPressed = storageKeyDown;
+
+    // switch length constraint once per key press
+    bool lengthModeKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_F);
+    if (lengthModeKeyDown && !lengthModeKeyPressed) {
+        lengthConstraintMode = lengthConstraintMode == HAIR_LENGTH_FTL ? HAIR_LENGTH_ITERATIVE : HAIR_LENGTH_FTL;
+        forcesToggled = true;
+        std::cout << "Length constraint of the first asset: " << (lengthConstraintMode == HAIR_LENGTH_FTL ? "follow the leader" : "iterative") << std::endl;
+    }
+    lengthModeKeyPressed = lengthModeKeyDown;
+
+    // switch render latency once per key press, main reports the mode switched off
+    bool latencyKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_O);
+    if (latencyKeyDown && !latencyKeyPressed) {
+        renderLatency = renderLatency == HAIR_RENDER_ONE_FRAME_LATENCY ? HAIR_RENDER_ZERO_LATENCY : HAIR_RENDER_ONE_FRAME_LATENCY;
+        std::cout << "Render latency: " << (renderLatency == HAIR_RENDER_ONE_FRAME_LATENCY ? "one frame" : "zero") << std::endl;
+    }
+    latencyKeyPressed = latencyKeyDown;
+
+    // print the GPU time per stage once per key press
+    bool gpuProfileKeyDown = inputRecorder.isKeyDown(window, GLFW_KEY_P);
+    if (gpuProfileKeyDown && !gpuProfileKeyPressed)
+        printGpuProfile = true;
+    gpuProfileKeyPressed = gpuProfileKeyDown;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -299,6 +1051,15 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    // a replay moves the cursor from the log
+    if (inputRecorder.getMode() == INPUT_REPLAY)
+        return;
+    inputRecorder.recordCursor(xpos, ypos, getWallSeconds());
+    moveCursor(xpos, ypos);
+}
+
+void moveCursor(double xpos, double ypos)
 {
     if (firstMouse)
     {
@@ -321,13 +1082,52 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    if (inputRecorder.getMode() == INPUT_REPLAY)
+        return;
+    inputRecorder.recordScroll(yoffset, getWallSeconds());
+    scroll(yoffset);
+}
+
+void scroll(double yoffset)
 {
     camera.ProcessMouseScroll(yoffset);
 }
 
 
 
+double getWallSeconds(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+glm::mat4 getAssetModelMatrix(int asset){
+    float offset = (asset - 0.5f * (noOfHairAssets - 1)) * hairAssetSpacing;
+    return model * glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, offset));
+}
+
+// World space box around the hair of all assets: the roots of every asset and
+// the length of a strand around them
+void getHairBounds(glm::vec3& lower, glm::vec3& upper){
+    float reach = verticesPerStrand * hairStrandLength;
+    lower = glm::vec3(FLT_MAX);
+    upper = glm::vec3(-FLT_MAX);
+    for(int asset = 0; asset < noOfHairAssets; asset++) {
+        glm::mat4 modelMatrix = getAssetModelMatrix(asset);
+        for(int corner = 0; corner < 8; corner++) {
+            glm::vec3 root((corner & 1) ? hairRootUpper.x : hairRootLower.x,
+                           (corner & 2) ? hairRootUpper.y : hairRootLower.y,
+                           (corner & 4) ? hairRootUpper.z : hairRootLower.z);
+            glm::vec3 position(modelMatrix * glm::vec4(root, 1.f));
+            lower = glm::min(lower, position);
+            upper = glm::max(upper, position);
+        }
+    }
+    lower -= reach;
+    upper += reach;
+}
+
 GLfloat* createMasterHairs(const Sphere& object){
+    CPU_PROFILE_ZONE("createMasterHairs");
     GLfloat* vertexArray = object.getVertexArray();
     noOfMasterHairs = object.getNoOfVertices();
 
@@ -337,8 +1137,8 @@ GLfloat* createMasterHairs(const Sphere& object){
     int masterHairIndex = 0;
     int stride = 8; // 8 because the vertexArray consists of (vertex (3), normal (3), tex (2))
     for(int i = 0; i < noOfMasterHairs*stride; i = i+stride){
+        // rest positions stay in object space, the simulation applies the model matrix
         glm::vec4 rootPos = glm::vec4(vertexArray[i], vertexArray[i+1], vertexArray[i+2], 1.f);
-        rootPos = model * rootPos;
         glm::vec4 rootNormal = glm::vec4(vertexArray[i+3], vertexArray[i+4], vertexArray[i+5], 0.f);
 
         hairData[masterHairIndex++] = rootPos.x;
@@ -358,13 +1158,17 @@ GLfloat* createMasterHairs(const Sphere& object){
     return hairData;
 }
 
-GLuint generateTextureFromHairData(GLfloat* hairData){
-    GLuint hairDataTextureID;
-    glGenTextures(1, &hairDataTextureID);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hairDataTextureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, verticesPerStrand * dataVariablesPerMasterHair, noOfMasterHairs, 0, GL_RGBA, GL_FLOAT, hairData);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    return hairDataTextureID;
+// #defines the hair shaders are specialised with (resolution, iteration counts, storage format)
+std::string getHairShaderDefines(){
+    return ShaderDefines()
+        .define("VERTICES_PER_STRAND", verticesPerStrand)
+        .define("LOCAL_SHAPE_ITERATIONS", localShapeIterations)
+        .define("LENGTH_CONSTRAINT_ITERATIONS", lengthConstraintIterations)
+        .append(HairStateBuffers::getShaderDefines(hairStorageFormat))
+        .str();
+}
+
+// local_size_y of the cooperative kernel, keeps its workgroups at invocationsPerWorkGroup
+int getStrandsPerWorkGroup(){
+    return std::max(1, invocationsPerWorkGroup / verticesPerStrand);
 }
@@ -0,0 +1,207 @@
+#include "CpuProfiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Zone
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    char detail[40];
+};
+
+// Single producer (the owning thread), single consumer (flush())
+struct ThreadRing
+{
+    Zone zones[CpuProfiler::ringSize];
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> read{0};
+    std::atomic<long> dropped{0};
+    int id = 0;
+    char name[32];
+    bool announced = false; // thread name written to the trace
+};
+
+// Rings outlive their threads, a worker that has exited may still have zones to flush
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadRing>> rings;
+int nextThreadId = 1;
+
+thread_local ThreadRing* threadRing = nullptr;
+thread_local char threadName[32] = "";
+
+std::ofstream trace;
+uint64_t traceStart = 0;
+bool firstEvent = true;
+
+const int gpuThreadId = 0;
+
+ThreadRing* getThreadRing()
+{
+    if(!threadRing) {
+        std::unique_ptr<ThreadRing> ring(new ThreadRing());
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->id = nextThreadId++;
+        if(threadName[0])
+            snprintf(ring->name, sizeof(ring->name), "%s", threadName);
+        else
+            snprintf(ring->name, sizeof(ring->name), "thread %d", ring->id);
+        threadRing = ring.get();
+        rings.push_back(std::move(ring));
+    }
+    return threadRing;
+}
+
+// Names and details are literals and file names, only quotes and backslashes need escaping
+void writeEscaped(const char* text)
+{
+    for(const char* c = text; *c; c++) {
+        if(*c == '"' || *c == '\\')
+            trace << '\\';
+        trace << *c;
+    }
+}
+
+void beginEvent()
+{
+    trace << (firstEvent ? "\n" : ",\n");
+    firstEvent = false;
+}
+
+void writeThreadName(int id, const char* name)
+{
+    beginEvent();
+    trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id << ",\"args\":{\"name\":\"";
+    writeEscaped(name);
+    trace << "\"}}";
+}
+
+void writeZone(int id, const char* name, const char* detail, uint64_t begin, uint64_t end)
+{
+    char numbers[96];
+    snprintf(numbers, sizeof(numbers), "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", id,
+             ((double)begin - (double)traceStart) * 1e-3, end > begin ? (end - begin) * 1e-3 : 0.0);
+    beginEvent();
+    trace << "{\"name\":\"";
+    writeEscaped(name);
+    trace << "\",\"ph\":\"X\"," << numbers;
+    if(detail && detail[0]) {
+        trace << ",\"args\":{\"detail\":\"";
+        writeEscaped(detail);
+        trace << "\"}";
+    }
+    trace << "}";
+}
+
+}
+
+std::atomic<bool> CpuProfiler::enabled(false);
+
+uint64_t CpuProfiler::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    snprintf(threadName, sizeof(threadName), "%s", name);
+}
+
+void CpuProfiler::record(const char* name, const char* detail, uint64_t begin, uint64_t end)
+{
+    ThreadRing* ring = getThreadRing();
+    uint64_t written = ring->written.load(std::memory_order_relaxed);
+    if(written - ring->read.load(std::memory_order_acquire) >= (uint64_t)ringSize) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Zone& zone = ring->zones[written % ringSize];
+    zone.name = name;
+    zone.begin = begin;
+    zone.end = end;
+    zone.detail[0] = '\0';
+    if(detail) {
+        // the file name without its directories
+        const char* slash = strrchr(detail, '/');
+        snprintf(zone.detail, sizeof(zone.detail), "%s", slash ? slash + 1 : detail);
+    }
+    ring->written.store(written + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::startTrace(const std::string& path)
+{
+    trace.open(path);
+    if(!trace) {
+        std::cout << "Failed to open CPU trace " << path << std::endl;
+        return false;
+    }
+    traceStart = now();
+    firstEvent = true;
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    writeThreadName(gpuThreadId, "GPU");
+    enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void CpuProfiler::flush()
+{
+    if(!trace.is_open())
+        return;
+    std::vector<ThreadRing*> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for(const std::unique_ptr<ThreadRing>& ring : rings)
+            snapshot.push_back(ring.get());
+    }
+    for(ThreadRing* ring : snapshot) {
+        if(!ring->announced) {
+            writeThreadName(ring->id, ring->name);
+            ring->announced = true;
+        }
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        uint64_t read = ring->read.load(std::memory_order_relaxed);
+        for(; read < written; read++) {
+            const Zone& zone = ring->zones[read % ringSize];
+            writeZone(ring->id, zone.name, zone.detail, zone.begin, zone.end);
+        }
+        ring->read.store(written, std::memory_order_release);
+    }
+}
+
+void CpuProfiler::addGpuZone(const std::string& name, uint64_t begin, uint64_t end)
+{
+    if(trace.is_open())
+        writeZone(gpuThreadId, name.c_str(), nullptr, begin, end);
+}
+
+void CpuProfiler::stopTrace()
+{
+    if(!trace.is_open())
+        return;
+    enabled.store(false, std::memory_order_relaxed);
+    flush();
+    trace << "\n]}\n";
+    trace.close();
+    long dropped = getDroppedZones();
+    if(dropped > 0)
+        std::cout << "CPU trace dropped " << dropped << " zones, flush more often" << std::endl;
+}
+
+long CpuProfiler::getDroppedZones()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    long dropped = 0;
+    for(const std::unique_ptr<ThreadRing>& ring : rings)
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
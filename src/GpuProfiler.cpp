@@ -0,0 +1,187 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+GpuProfiler::GpuProfiler()
+    : currentFrame(0), frameNumber(0), measuredFrames(0), droppedFrames(0)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for(Frame& frame : frames)
+        if(!frame.queries.empty())
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+}
+
+int GpuProfiler::addStage(const std::string& name)
+{
+    Stage stage;
+    stage.name = name;
+    stages.push_back(stage);
+    return (int)stages.size() - 1;
+}
+
+void GpuProfiler::beginFrame()
+{
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    Frame& frame = frames[currentFrame];
+    if(frame.pending)
+        collect(frame);
+    frame.noOfPairs = 0;
+    frame.pending = true;
+    for(Stage& stage : stages)
+        stage.open = -1;
+}
+
+void GpuProfiler::begin(int stage)
+{
+    Frame& frame = frames[currentFrame];
+    if(2 * frame.noOfPairs == (int)frame.queries.size()) {
+        size_t size = frame.queries.size();
+        frame.queries.resize(std::max<size_t>(2 * size, 16));
+        glGenQueries((GLsizei)(frame.queries.size() - size), frame.queries.data() + size);
+        frame.pairStages.resize(frame.queries.size() / 2);
+    }
+    int pair = frame.noOfPairs++;
+    frame.pairStages[pair] = stage;
+    stages[stage].open = pair;
+    glQueryCounter(frame.queries[2 * pair], GL_TIMESTAMP);
+    frame.lastQuery = frame.queries[2 * pair];
+}
+
+void GpuProfiler::end(int stage)
+{
+    int pair = stages[stage].open;
+    if(pair < 0)
+        return;
+    Frame& frame = frames[currentFrame];
+    glQueryCounter(frame.queries[2 * pair + 1], GL_TIMESTAMP);
+    frame.lastQuery = frame.queries[2 * pair + 1];
+    stages[stage].open = -1;
+}
+
+void GpuProfiler::endFrame()
+{
+    // a stage left open ends with the frame
+    for(int stage = 0; stage < (int)stages.size(); stage++)
+        end(stage);
+    frameNumber++;
+}
+
+void GpuProfiler::collect(Frame& frame)
+{
+    frame.pending = false;
+    if(frame.noOfPairs == 0)
+        return;
+
+    // timestamps complete in order, the last one issued tells for the whole frame
+    GLint available = 0;
+    glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available) {
+        droppedFrames++;
+        return;
+    }
+
+    std::vector<double> stageTimes(stages.size(), 0.0);
+    std::vector<bool> ran(stages.size(), false);
+    for(int pair = 0; pair < frame.noOfPairs; pair++) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[2 * pair], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[2 * pair + 1], GL_QUERY_RESULT, &end);
+        int stage = frame.pairStages[pair];
+        stageTimes[stage] += end > begin ? (end - begin) * 1e-6 : 0.0;
+        ran[stage] = true;
+        if(runCallback)
+            runCallback(stage, begin, end);
+    }
+    for(size_t i = 0; i < stages.size(); i++) {
+        if(!ran[i])
+            continue;
+        Stage& stage = stages[i];
+        if((int)stage.window.size() < windowSize)
+            stage.window.push_back(stageTimes[i]);
+        else
+            stage.window[stage.next] = stageTimes[i];
+        stage.next = (stage.next + 1) % windowSize;
+    }
+    measuredFrames++;
+}
+
+GpuProfiler::Statistics GpuProfiler::getStatistics(int stage) const
+{
+    Statistics statistics;
+    const Stage& s = stages[stage];
+    if(s.window.empty())
+        return statistics;
+
+    std::vector<double> sorted = s.window;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for(double time : sorted)
+        sum += time;
+    // nearest rank percentiles
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p * sorted.size());
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    };
+
+    statistics.samples = (int)sorted.size();
+    statistics.last = s.window[(s.next + s.window.size() - 1) % s.window.size()];
+    statistics.min = sorted.front();
+    statistics.mean = sum / sorted.size();
+    statistics.p95 = percentile(0.95);
+    statistics.p99 = percentile(0.99);
+    return statistics;
+}
+
+void GpuProfiler::print(std::ostream& out) const
+{
+    char line[256];
+    snprintf(line, sizeof(line), "GPU time per frame in ms, last %d frames (%d measured, %d dropped)\n",
+             windowSize, measuredFrames, droppedFrames);
+    out << line;
+    snprintf(line, sizeof(line), "  %-24s %8s %8s %8s %8s %8s\n", "stage", "last", "min", "mean", "p95", "p99");
+    out << line;
+    for(int stage = 0; stage < getNoOfStages(); stage++) {
+        Statistics s = getStatistics(stage);
+        snprintf(line, sizeof(line), "  %-24s %8.3f %8.3f %8.3f %8.3f %8.3f\n",
+                 stages[stage].name.c_str(), s.last, s.min, s.mean, s.p95, s.p99);
+        out << line;
+    }
+}
+
+void GpuProfiler::writeCsv(std::ostream& out, bool header) const
+{
+    if(header)
+        out << "frame,stage,samples,last_ms,min_ms,mean_ms,p95_ms,p99_ms\n";
+    char line[256];
+    for(int stage = 0; stage < getNoOfStages(); stage++) {
+        Statistics s = getStatistics(stage);
+        snprintf(line, sizeof(line), "%d,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f\n", frameNumber, stages[stage].name.c_str(),
+                 s.samples, s.last, s.min, s.mean, s.p95, s.p99);
+        out << line;
+    }
+    out.flush();
+}
+
+void GpuProfiler::writeJson(std::ostream& out) const
+{
+    char line[256];
+    snprintf(line, sizeof(line), "{\n  \"frame\": %d,\n  \"measuredFrames\": %d,\n  \"droppedFrames\": %d,\n  \"stages\": [\n",
+             frameNumber, measuredFrames, droppedFrames);
+    out << line;
+    for(int stage = 0; stage < getNoOfStages(); stage++) {
+        Statistics s = getStatistics(stage);
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"samples\": %d, \"lastMs\": %.6f, \"minMs\": %.6f, \"meanMs\": %.6f, \"p95Ms\": %.6f, \"p99Ms\": %.6f}%s\n",
+                 stages[stage].name.c_str(), s.samples, s.last, s.min, s.mean, s.p95, s.p99,
+                 stage + 1 < getNoOfStages() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    out.flush();
+}
@@ -0,0 +1,121 @@
+#include "HairActivity.h"
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+// std430 element of the strand activity buffer
+struct StrandActivity
+{
+    GLfloat kineticEnergy;
+    GLuint calmSteps;
+    GLuint updateInterval;
+    GLfloat wind[3]; // at the root when the strand was last awake
+};
+
+// glDispatchComputeIndirect commands; the single kernel runs one workgroup per
+// strand in y, the cooperative kernel strandsPerWorkGroup strands per workgroup in x
+// and the extrapolation extrapolationGroupSize strands per workgroup in x
+struct DispatchCommands
+{
+    GLuint singleGroups[3];
+    GLuint cooperativeGroups[3];
+    GLuint extrapolationGroups[3];
+    GLuint skippedStrandCount;
+};
+
+const DispatchCommands emptyDispatch = {{1, 0, 1}, {0, 1, 1}, {0, 1, 1}, 0};
+
+}
+
+HairActivity::HairActivity(int noOfMasterHairs)
+    : noOfMasterHairs(noOfMasterHairs), hasForces(false)
+{
+    // Every strand starts awake
+    std::vector<StrandActivity> activity(noOfMasterHairs, StrandActivity{FLT_MAX, 0, 1, {0.f, 0.f, 0.f}});
+
+    glGenBuffers(1, &activityBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, activityBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, activity.size() * sizeof(StrandActivity), activity.data(), GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &activeStrandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeStrandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, noOfMasterHairs * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &skippedStrandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, skippedStrandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, noOfMasterHairs * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &dispatchBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DispatchCommands), &emptyDispatch, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+HairActivity::~HairActivity()
+{
+    glDeleteBuffers(1, &dispatchBuffer);
+    glDeleteBuffers(1, &skippedStrandBuffer);
+    glDeleteBuffers(1, &activeStrandBuffer);
+    glDeleteBuffers(1, &activityBuffer);
+}
+
+bool HairActivity::forcesChanged(const HairSolverParameters& parameters)
+{
+    // The model matrix is left out, root motion wakes strands one by one. So is
+    // windMagnitude: it gusts every frame, HairActivity.comp compares the wind at
+    // each root instead and only wakes the strands it would move.
+    bool changed = !hasForces ||
+        parameters.timeStep != forces.timeStep ||
+        parameters.damping != forces.damping ||
+        parameters.hairStrandLength != forces.hairStrandLength ||
+        parameters.windDirection != forces.windDirection ||
+        parameters.lengthConstraintMode != forces.lengthConstraintMode ||
+        parameters.ftlDamping != forces.ftlDamping;
+    forces = parameters;
+    hasForces = true;
+    return changed;
+}
+
+void HairActivity::bindForClassification()
+{
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DispatchCommands), &emptyDispatch);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, activityBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, activeStrandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, dispatchBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, skippedStrandBuffer);
+}
+
+void HairActivity::dispatchClassification() const
+{
+    glDispatchCompute((noOfMasterHairs + classificationGroupSize - 1) / classificationGroupSize, 1, 1);
+}
+
+void HairActivity::dispatchSimulation(bool cooperativeKernel) const
+{
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatchBuffer);
+    glDispatchComputeIndirect(cooperativeKernel ? offsetof(DispatchCommands, cooperativeGroups)
+                                                : offsetof(DispatchCommands, singleGroups));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+void HairActivity::dispatchExtrapolation() const
+{
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatchBuffer);
+    glDispatchComputeIndirect(offsetof(DispatchCommands, extrapolationGroups));
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+int HairActivity::readActiveStrandCount() const
+{
+    DispatchCommands commands;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DispatchCommands), &commands);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return (int)commands.singleGroups[1];
+}
@@ -0,0 +1,51 @@
+#include "HairAssets.h"
+
+#include <algorithm>
+
+
+HairAssets::HairAssets()
+    : parametersDirty(true), strandsDirty(true)
+{
+    glGenBuffers(1, &parameterBuffer);
+    glGenBuffers(1, &strandAssetBuffer);
+}
+
+HairAssets::~HairAssets()
+{
+    glDeleteBuffers(1, &strandAssetBuffer);
+    glDeleteBuffers(1, &parameterBuffer);
+}
+
+int HairAssets::add(int noOfStrands, const HairAssetParameters& assetParameters)
+{
+    int asset = (int)parameters.size();
+    parameters.push_back(assetParameters);
+    parameters.back().firstStrand = (int)strandAssets.size();
+    parameters.back().noOfStrands = noOfStrands;
+    strandAssets.insert(strandAssets.end(), noOfStrands, (GLuint)asset);
+    parametersDirty = true;
+    strandsDirty = true;
+    return asset;
+}
+
+void HairAssets::bind()
+{
+    // empty buffers cannot be bound, keep room for one element
+    if(strandsDirty) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, strandAssetBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(strandAssets.size(), 1) * sizeof(GLuint),
+                     strandAssets.empty() ? NULL : strandAssets.data(), GL_STATIC_DRAW);
+        strandsDirty = false;
+    }
+    if(parametersDirty) {
+        for(HairAssetParameters& asset : parameters)
+            asset.inverseModelMatrix = glm::inverse(asset.modelMatrix);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, parameterBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(parameters.size(), 1) * sizeof(HairAssetParameters),
+                     parameters.empty() ? NULL : parameters.data(), GL_DYNAMIC_DRAW);
+        parametersDirty = false;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, parameterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, strandAssetBuffer);
+}
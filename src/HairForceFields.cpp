@@ -0,0 +1,112 @@
+#include "HairForceFields.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+HairForceField makeField(HairForceFieldType type, const glm::vec3& center, float radius,
+                         const glm::vec3& direction, float strength, float falloff)
+{
+    HairForceField field;
+    field.center = glm::vec4(center, std::max(radius, 0.f));
+    field.direction = glm::vec4(direction, strength);
+    field.type = type;
+    field.falloff = falloff;
+    return field;
+}
+
+}
+
+HairForceFields::HairForceFields()
+    : bufferCapacity(0), dirty(true), overlapWarned(false)
+{
+    glGenBuffers(1, &fieldBuffer);
+}
+
+HairForceFields::~HairForceFields()
+{
+    glDeleteBuffers(1, &fieldBuffer);
+}
+
+int HairForceFields::add(const HairForceField& field)
+{
+    fields.push_back(field);
+    dirty = true;
+    return (int)fields.size() - 1;
+}
+
+void HairForceFields::clear()
+{
+    fields.clear();
+    dirty = true;
+}
+
+void HairForceFields::bind(float strandReach)
+{
+    int overlapping = getMaxOverlappingFields(strandReach);
+    if(overlapping > maxFieldsPerGroup && !overlapWarned)
+        std::cout << "WARNING::HAIR_FORCE_FIELDS: " << overlapping << " force fields can reach the same strand, only the "
+                  << maxFieldsPerGroup << " with the lowest indices act on it" << std::endl;
+    overlapWarned = overlapping > maxFieldsPerGroup;
+
+    if(dirty) {
+        // an empty buffer cannot be bound, keep room for one field
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, fieldBuffer);
+        if(fields.size() > bufferCapacity || bufferCapacity == 0) {
+            bufferCapacity = std::max<size_t>(fields.size(), 1);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, bufferCapacity * sizeof(HairForceField), NULL, GL_DYNAMIC_DRAW);
+        }
+        if(!fields.empty())
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, fields.size() * sizeof(HairForceField), fields.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        dirty = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, fieldBuffer);
+}
+
+int HairForceFields::getMaxOverlappingFields(float strandReach) const
+{
+    int maxOverlapping = 0;
+    for(const HairForceField& field : fields) {
+        int overlapping = 0;
+        for(const HairForceField& other : fields) {
+            bool global = field.center.w <= 0.f || other.center.w <= 0.f;
+            float reach = field.center.w + other.center.w + 2.f * strandReach;
+            if(global || glm::distance(glm::vec3(field.center), glm::vec3(other.center)) < reach)
+                overlapping++;
+        }
+        maxOverlapping = std::max(maxOverlapping, overlapping);
+    }
+    return maxOverlapping;
+}
+
+HairForceField HairForceFields::point(const glm::vec3& center, float radius, float strength, float falloff)
+{
+    return makeField(HAIR_FIELD_POINT, center, radius, glm::vec3(0.f), strength, falloff);
+}
+
+HairForceField HairForceFields::directional(const glm::vec3& center, float radius, const glm::vec3& direction,
+                                            float strength, float falloff)
+{
+    return makeField(HAIR_FIELD_DIRECTIONAL, center, radius, glm::normalize(direction), strength, falloff);
+}
+
+HairForceField HairForceFields::vortex(const glm::vec3& center, float radius, const glm::vec3& axis,
+                                       float strength, float falloff)
+{
+    return makeField(HAIR_FIELD_VORTEX, center, radius, glm::normalize(axis), strength, falloff);
+}
+
+HairForceField HairForceFields::turbulence(const glm::vec3& center, float radius, float strength,
+                                           float frequency, float falloff)
+{
+    HairForceField field = makeField(HAIR_FIELD_TURBULENCE, center, radius, glm::vec3(0.f), strength, falloff);
+    field.frequency = frequency;
+    return field;
+}
+
+HairForceField HairForceFields::drag(const glm::vec3& center, float radius, float strength, float falloff)
+{
+    return makeField(HAIR_FIELD_DRAG, center, radius, glm::vec3(0.f), strength, falloff);
+}
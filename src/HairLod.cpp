@@ -0,0 +1,218 @@
+#include "HairLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+#include <gtc/constants.hpp>
+
+
+HairLod::HairLod(const GLfloat* hairData, const HairAssets& assets, int verticesPerStrand, int guidesInFirstLevel)
+    : noOfMasterHairs(assets.getNoOfStrands())
+{
+    std::vector<glm::vec3> roots(noOfMasterHairs);
+    std::vector<std::pair<float, int>> mergeKeys; // position in the merged ranking, strand
+    for(int asset = 0; asset < assets.getNoOfAssets(); asset++) {
+        const HairAssetParameters& parameters = assets.getParameters(asset);
+        std::vector<int> strands;
+        glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+        for(int strand = parameters.firstStrand; strand < parameters.firstStrand + parameters.noOfStrands; strand++) {
+            const GLfloat* root = hairData + 4 * strand * verticesPerStrand;
+            roots[strand] = glm::vec3(root[0], root[1], root[2]);
+            strands.push_back(strand);
+            for(int i = 0; i < verticesPerStrand; i++) {
+                glm::vec3 position(root[4*i], root[4*i+1], root[4*i+2]);
+                lower = glm::min(lower, position);
+                upper = glm::max(upper, position);
+            }
+        }
+        if(strands.empty())
+            lower = upper = glm::vec3(0.f);
+        boundingCenters.push_back(0.5f * (lower + upper));
+        boundingRadii.push_back(0.5f * glm::length(upper - lower));
+
+        // The first three strands of every asset lead, level 0 needs them to
+        // interpolate the others from
+        std::vector<int> assetRanking;
+        rankStrands(roots, strands, assetRanking);
+        int n = (int)assetRanking.size();
+        for(int rank = 0; rank < n; rank++)
+            mergeKeys.push_back(std::make_pair(rank < 3 ? rank - 3.f : (rank + 0.5f) / n, assetRanking[rank]));
+    }
+    // ties go to the lower asset, whose strands come first
+    std::stable_sort(mergeKeys.begin(), mergeKeys.end(),
+                     [](const std::pair<float, int>& a, const std::pair<float, int>& b){ return a.first < b.first; });
+    std::vector<int> ranking;
+    for(const std::pair<float, int>& key : mergeKeys)
+        ranking.push_back(key.second);
+
+    levelStarts.push_back(0);
+    for(int start = std::max(guidesInFirstLevel, 3 * assets.getNoOfAssets()); start < noOfMasterHairs; start *= 2)
+        levelStarts.push_back(start);
+    levelStarts.push_back(noOfMasterHairs);
+    level = (float)getNoOfLevels();
+
+    // Parents: the three nearest roots of the coarser levels of the same asset,
+    // weighted by inverse distance. A root that coincides with its parent (seams of
+    // the emitter) just follows that parent.
+    std::vector<Guide> guides(noOfMasterHairs);
+    for(int l = 0; l < getNoOfLevels(); l++) {
+        for(int rank = levelStarts[l]; rank < levelStarts[l+1]; rank++) {
+            int strand = ranking[rank];
+            int asset = assets.getAsset(strand);
+            Guide& guide = guides[strand];
+            guide.rank = rank;
+            guide.weights[3] = 0.f;
+            for(int k = 0; k < 3; k++)
+                guide.parents[k] = strand;
+            if(l == 0) {
+                for(int k = 0; k < 3; k++)
+                    guide.weights[k] = k == 0 ? 1.f : 0.f;
+                continue;
+            }
+
+            const float minDistance = 1e-4f * boundingRadii[asset];
+            float distances[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+            for(int parentRank = 0; parentRank < levelStarts[l]; parentRank++) {
+                int parent = ranking[parentRank];
+                if(assets.getAsset(parent) != asset)
+                    continue;
+                float distance = glm::length(roots[parent] - roots[strand]);
+                for(int k = 0; k < 3; k++) {
+                    if(distance < distances[k]) {
+                        for(int m = 2; m > k; m--) {
+                            distances[m] = distances[m-1];
+                            guide.parents[m] = guide.parents[m-1];
+                        }
+                        distances[k] = distance;
+                        guide.parents[k] = parent;
+                        break;
+                    }
+                }
+            }
+
+            float weightSum = 0.f;
+            for(int k = 0; k < 3; k++) {
+                guide.weights[k] = distances[0] < minDistance ? (k == 0 ? 1.f : 0.f) : 1.f / distances[k];
+                weightSum += guide.weights[k];
+            }
+            for(int k = 0; k < 3; k++)
+                guide.weights[k] /= weightSum;
+        }
+    }
+
+    glGenBuffers(1, &guideBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, guideBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, guides.size() * sizeof(Guide), guides.data(), GL_STATIC_DRAW);
+
+    std::vector<GLuint> rankingData(ranking.begin(), ranking.end());
+    glGenBuffers(1, &rankingBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, rankingBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, rankingData.size() * sizeof(GLuint), rankingData.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+HairLod::~HairLod()
+{
+    glDeleteBuffers(1, &rankingBuffer);
+    glDeleteBuffers(1, &guideBuffer);
+}
+
+void HairLod::rankStrands(const std::vector<glm::vec3>& roots, const std::vector<int>& strands, std::vector<int>& ranking) const
+{
+    // Farthest point sampling: every rank goes to the root farthest from all
+    // roots ranked before it
+    int n = (int)strands.size();
+    std::vector<float> distances(n, FLT_MAX);
+    std::vector<bool> ranked(n, false);
+    ranking.clear();
+    int next = 0;
+    while((int)ranking.size() < n) {
+        ranking.push_back(strands[next]);
+        ranked[next] = true;
+        int farthest = -1;
+        for(int i = 0; i < n; i++) {
+            if(ranked[i])
+                continue;
+            distances[i] = std::min(distances[i], glm::length(roots[strands[i]] - roots[strands[next]]));
+            if(farthest < 0 || distances[i] > distances[farthest])
+                farthest = i;
+        }
+        next = farthest;
+    }
+}
+
+float HairLod::getLevelForGuides(float guides) const
+{
+    int noOfLevels = getNoOfLevels();
+    for(int l = 1; l < noOfLevels; l++) {
+        if(guides < levelStarts[l+1])
+            return l + std::max(0.f, guides - levelStarts[l]) / (levelStarts[l+1] - levelStarts[l]);
+    }
+    return (float)noOfLevels;
+}
+
+void HairLod::update(const HairAssets& assets, const glm::mat4& view, const glm::mat4& projection, float viewportHeight,
+                     float pixelsPerGuide, float fadeLevelsPerSecond, float deltaTime)
+{
+    float guides = 0.f;
+    bool inside = false;
+    for(int asset = 0; asset < assets.getNoOfAssets(); asset++) {
+        glm::mat4 modelView = view * assets.getParameters(asset).modelMatrix;
+        glm::vec4 center = modelView * glm::vec4(boundingCenters[asset], 1.f);
+        float radius = boundingRadii[asset] * glm::length(glm::vec3(modelView[0]));
+        float distance = -center.z;
+        if(distance <= radius) {
+            inside = true;
+            break;
+        }
+        // radius in pixels of the projected bounding sphere
+        float projectedRadius = radius / distance * projection[1][1] * 0.5f * viewportHeight;
+        guides += glm::pi<float>() * projectedRadius * projectedRadius / pixelsPerGuide;
+    }
+    float targetLevel = inside ? (float)getNoOfLevels() : getLevelForGuides(guides);
+
+    float maxChange = fadeLevelsPerSecond * deltaTime;
+    level += glm::clamp(targetLevel - level, -maxChange, maxChange);
+}
+
+void HairLod::simulateAll()
+{
+    level = (float)getNoOfLevels();
+}
+
+int HairLod::getSimulatedStrands() const
+{
+    int l = (int)level;
+    if(l >= getNoOfLevels())
+        return noOfMasterHairs;
+    return level > l ? levelStarts[l+1] : levelStarts[l];
+}
+
+int HairLod::getFadingRank() const
+{
+    int l = (int)level;
+    return l >= getNoOfLevels() ? noOfMasterHairs : levelStarts[l];
+}
+
+void HairLod::bindBuffers() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, guideBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, rankingBuffer);
+}
+
+void HairLod::dispatchInterpolation(ComputeShader& interpolationShader) const
+{
+    // Each level reads the final positions of the coarser ones
+    interpolationShader.use();
+    int fadingLevel = (int)level;
+    for(int l = fadingLevel; l < getNoOfLevels(); l++) {
+        int noOfStrands = levelStarts[l+1] - levelStarts[l];
+        interpolationShader.setInt("firstRank", levelStarts[l]);
+        interpolationShader.setInt("noOfStrands", noOfStrands);
+        interpolationShader.setFloat("blend", l == fadingLevel ? level - fadingLevel : 0.f);
+        glDispatchCompute((noOfStrands + interpolationGroupSize - 1) / interpolationGroupSize, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
@@ -0,0 +1,41 @@
+#include "HairSimdKernel.h"
+
+// This file is compiled with -mavx2 (see CMakeLists.txt). The kernel is only
+// called after HairSolverSimd has checked that the CPU supports AVX2.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+// 8 strands per __m256
+struct SimdLanesAvx2
+{
+    static const int lanes = 8;
+    __m256 v;
+
+    static SimdLanesAvx2 load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static SimdLanesAvx2 set(float value) { return { _mm256_set1_ps(value) }; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend SimdLanesAvx2 operator+(SimdLanesAvx2 a, SimdLanesAvx2 b) { return { _mm256_add_ps(a.v, b.v) }; }
+    friend SimdLanesAvx2 operator-(SimdLanesAvx2 a, SimdLanesAvx2 b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    friend SimdLanesAvx2 operator*(SimdLanesAvx2 a, SimdLanesAvx2 b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    friend SimdLanesAvx2 operator/(SimdLanesAvx2 a, SimdLanesAvx2 b) { return { _mm256_div_ps(a.v, b.v) }; }
+    friend SimdLanesAvx2 sqrt(SimdLanesAvx2 a) { return { _mm256_sqrt_ps(a.v) }; }
+};
+
+}
+
+HairSimdKernel getHairSimdKernelAvx2()
+{
+    return simulateHairBlocks<SimdLanesAvx2>;
+}
+
+#else
+
+HairSimdKernel getHairSimdKernelAvx2()
+{
+    return nullptr;
+}
+
+#endif
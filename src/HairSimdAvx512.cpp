@@ -0,0 +1,41 @@
+#include "HairSimdKernel.h"
+
+// This file is compiled with -mavx512f (see CMakeLists.txt). The kernel is only
+// called after HairSolverSimd has checked that the CPU supports AVX-512F.
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace {
+
+// 16 strands per __m512
+struct SimdLanesAvx512
+{
+    static const int lanes = 16;
+    __m512 v;
+
+    static SimdLanesAvx512 load(const float* p) { return { _mm512_loadu_ps(p) }; }
+    static SimdLanesAvx512 set(float value) { return { _mm512_set1_ps(value) }; }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+    friend SimdLanesAvx512 operator+(SimdLanesAvx512 a, SimdLanesAvx512 b) { return { _mm512_add_ps(a.v, b.v) }; }
+    friend SimdLanesAvx512 operator-(SimdLanesAvx512 a, SimdLanesAvx512 b) { return { _mm512_sub_ps(a.v, b.v) }; }
+    friend SimdLanesAvx512 operator*(SimdLanesAvx512 a, SimdLanesAvx512 b) { return { _mm512_mul_ps(a.v, b.v) }; }
+    friend SimdLanesAvx512 operator/(SimdLanesAvx512 a, SimdLanesAvx512 b) { return { _mm512_div_ps(a.v, b.v) }; }
+    friend SimdLanesAvx512 sqrt(SimdLanesAvx512 a) { return { _mm512_sqrt_ps(a.v) }; }
+};
+
+}
+
+HairSimdKernel getHairSimdKernelAvx512()
+{
+    return simulateHairBlocks<SimdLanesAvx512>;
+}
+
+#else
+
+HairSimdKernel getHairSimdKernelAvx512()
+{
+    return nullptr;
+}
+
+#endif
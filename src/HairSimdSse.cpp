@@ -0,0 +1,39 @@
+#include "HairSimdKernel.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+namespace {
+
+// 4 strands per __m128
+struct SimdLanesSse
+{
+    static const int lanes = 4;
+    __m128 v;
+
+    static SimdLanesSse load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static SimdLanesSse set(float value) { return { _mm_set1_ps(value) }; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend SimdLanesSse operator+(SimdLanesSse a, SimdLanesSse b) { return { _mm_add_ps(a.v, b.v) }; }
+    friend SimdLanesSse operator-(SimdLanesSse a, SimdLanesSse b) { return { _mm_sub_ps(a.v, b.v) }; }
+    friend SimdLanesSse operator*(SimdLanesSse a, SimdLanesSse b) { return { _mm_mul_ps(a.v, b.v) }; }
+    friend SimdLanesSse operator/(SimdLanesSse a, SimdLanesSse b) { return { _mm_div_ps(a.v, b.v) }; }
+    friend SimdLanesSse sqrt(SimdLanesSse a) { return { _mm_sqrt_ps(a.v) }; }
+};
+
+}
+
+HairSimdKernel getHairSimdKernelSse()
+{
+    return simulateHairBlocks<SimdLanesSse>;
+}
+
+#else
+
+HairSimdKernel getHairSimdKernelSse()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "HairSnapshot.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+template <class T>
+void write(std::ofstream& out, T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+bool read(std::ifstream& in, T& value)
+{
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+double getDistance(const float* a, const float* b)
+{
+    double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+}
+
+HairSnapshot::HairSnapshot()
+    : noOfMasterHairs(0), verticesPerStrand(0), restSegmentLength(0.f), steps(0)
+{
+}
+
+HairSnapshot::HairSnapshot(int noOfMasterHairs, int verticesPerStrand, float restSegmentLength, int steps)
+    : noOfMasterHairs(noOfMasterHairs), verticesPerStrand(verticesPerStrand), restSegmentLength(restSegmentLength),
+      steps(steps), positions((size_t)noOfMasterHairs * verticesPerStrand * 4)
+{
+}
+
+bool HairSnapshot::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if(!out) {
+        std::cout << "Failed to write hair snapshot " << path << std::endl;
+        return false;
+    }
+    write(out, magic);
+    write(out, version);
+    write(out, (int32_t)noOfMasterHairs);
+    write(out, (int32_t)verticesPerStrand);
+    write(out, restSegmentLength);
+    write(out, (int32_t)steps);
+    out.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(float));
+    return (bool)out;
+}
+
+bool HairSnapshot::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    uint32_t fileMagic = 0, fileVersion = 0;
+    int32_t strands = 0, vertices = 0, fileSteps = 0;
+    float segmentLength = 0.f;
+    if(!in || !read(in, fileMagic) || !read(in, fileVersion) || fileMagic != magic || fileVersion != version ||
+       !read(in, strands) || !read(in, vertices) || !read(in, segmentLength) || !read(in, fileSteps) ||
+       strands < 0 || vertices < 0) {
+        std::cout << "Failed to open hair snapshot " << path << ", not a snapshot of version " << version << std::endl;
+        return false;
+    }
+    noOfMasterHairs = strands;
+    verticesPerStrand = vertices;
+    restSegmentLength = segmentLength;
+    steps = fileSteps;
+    positions.resize((size_t)noOfMasterHairs * verticesPerStrand * 4);
+    if(!in.read(reinterpret_cast<char*>(positions.data()), positions.size() * sizeof(float))) {
+        std::cout << "Hair snapshot " << path << " is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+HairSnapshotComparison HairSnapshot::compare(const HairSnapshot& result, const HairSnapshotTolerances& tolerances) const
+{
+    HairSnapshotComparison comparison;
+    comparison.sameShape = noOfMasterHairs == result.noOfMasterHairs && verticesPerStrand == result.verticesPerStrand;
+    if(!comparison.sameShape || positions.empty())
+        return comparison;
+
+    double squares = 0.0;
+    for(int strand = 0; strand < noOfMasterHairs; strand++) {
+        const float* golden = &positions[(size_t)strand * verticesPerStrand * 4];
+        const float* other = &result.positions[(size_t)strand * verticesPerStrand * 4];
+        for(int vertex = 0; vertex < verticesPerStrand; vertex++) {
+            double deviation = getDistance(golden + 4 * vertex, other + 4 * vertex);
+            squares += deviation * deviation;
+            if(deviation > comparison.maxDeviation || std::isnan(deviation)) {
+                comparison.maxDeviation = deviation;
+                comparison.worstStrand = strand;
+            }
+            if(vertex > 0) {
+                double goldenLength = getDistance(golden + 4 * vertex, golden + 4 * (vertex - 1));
+                double length = getDistance(other + 4 * vertex, other + 4 * (vertex - 1));
+                double error = std::fabs(length - goldenLength) / (restSegmentLength > 0.f ? restSegmentLength : 1.0);
+                if(error > comparison.maxSegmentLengthError || std::isnan(error))
+                    comparison.maxSegmentLengthError = error;
+            }
+        }
+    }
+    comparison.rmsDeviation = std::sqrt(squares / ((double)noOfMasterHairs * verticesPerStrand));
+    // written so that NaN fails
+    comparison.passed = comparison.maxDeviation <= tolerances.maxDeviation &&
+                        comparison.rmsDeviation <= tolerances.rmsDeviation &&
+                        comparison.maxSegmentLengthError <= tolerances.segmentLengthError;
+    return comparison;
+}
+
+void HairSnapshot::printComparison(std::ostream& out, const std::string& name, const HairSnapshotComparison& comparison,
+                                   const HairSnapshotTolerances& tolerances)
+{
+    char line[256];
+    if(!comparison.sameShape) {
+        snprintf(line, sizeof(line), "%-16s FAILED, strand or vertex count differs from the golden snapshot\n", name.c_str());
+        out << line;
+        return;
+    }
+    snprintf(line, sizeof(line), "%-16s %s  max %.3g (%.3g)  rms %.3g (%.3g)  segment length %.3g (%.3g)  worst strand %d\n",
+             name.c_str(), comparison.passed ? "passed" : "FAILED", comparison.maxDeviation, tolerances.maxDeviation,
+             comparison.rmsDeviation, tolerances.rmsDeviation, comparison.maxSegmentLengthError,
+             tolerances.segmentLengthError, comparison.worstStrand);
+    out << line;
+}
@@ -0,0 +1,245 @@
+#include "HairSolver.h"
+#include "StrandScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Constants of the constraint stages, same values as in HairSimulation.comp
+static const float maxStiffness = 0.8f;       // stiffness of the global shape constraint at the root
+static const float localStiffness = 0.005f;   // stiffness of the local shape constraint
+static const glm::vec3 gravity(0.f, -9.8f, 0.f);
+
+
+HairSolver::HairSolver(const float* hairData, int noOfMasterHairs, int verticesPerStrand)
+    : noOfMasterHairs(noOfMasterHairs), verticesPerStrand(verticesPerStrand),
+      previous(0), current(1), next(2)
+{
+    // hairData has verticesPerStrand vertices per strand, clamping the count would
+    // misalign every strand after the first
+    if(!isSupported(verticesPerStrand)) {
+        std::cout << "ERROR::HAIR_SOLVER: " << verticesPerStrand << " vertices per strand, 2 to "
+                  << maxVerticesPerStrand << " are supported; the solver holds no strands" << std::endl;
+        this->noOfMasterHairs = noOfMasterHairs = 0;
+    }
+
+    int noOfVertices = noOfMasterHairs * verticesPerStrand;
+    rest.x.resize(noOfVertices);
+    rest.y.resize(noOfVertices);
+    rest.z.resize(noOfVertices);
+    for(int i = 0; i < noOfVertices; i++) {
+        rest.x[i] = hairData[4*i];
+        rest.y[i] = hairData[4*i+1];
+        rest.z[i] = hairData[4*i+2];
+    }
+    // The simulation starts at rest, like the textures created in main.cpp
+    for(PositionBuffer& buffer : positions)
+        buffer = rest;
+}
+
+void HairSolver::simulate(const HairSolverParameters& parameters, StrandScheduler* scheduler)
+{
+    if(scheduler != nullptr) {
+        int chunkSize = StrandScheduler::getChunkSize(getBytesPerStrand());
+        scheduler->parallelFor(noOfMasterHairs, chunkSize, [&](int first, int last, int) {
+            simulateStrands(first, last, parameters);
+        });
+    }
+    else {
+        simulateStrands(0, noOfMasterHairs, parameters);
+    }
+    swapBuffers();
+}
+
+void HairSolver::simulateStrands(int firstStrand, int lastStrand, const HairSolverParameters& parameters)
+{
+    const int n = verticesPerStrand;
+    const glm::mat4& modelMatrix = parameters.modelMatrix;
+    const float timeStep2 = parameters.timeStep * parameters.timeStep;
+    const float velocityScale = 1.0f - parameters.damping;
+    const float strandLength = parameters.hairStrandLength;
+    const float ftlDamping = parameters.ftlDamping;
+
+    // the kernels sample this wind from the wind field, which adds the gusts
+    const glm::vec3 wind = parameters.windMagnitude * getUniformWind(parameters.windDirection);
+
+    const PositionBuffer& oldPositions = positions[previous];
+    PositionBuffer& currPositions = positions[current]; // receives the FTL velocity correction
+    PositionBuffer& newPositions = positions[next];
+
+    glm::vec3 restPos[maxVerticesPerStrand];
+    glm::vec3 newPos[maxVerticesPerStrand];
+
+    for(int strand = firstStrand; strand < lastStrand; strand++) {
+        const int base = strand * n;
+        const float* restX = &rest.x[base];
+        const float* restY = &rest.y[base];
+        const float* restZ = &rest.z[base];
+        const float* oldX = &oldPositions.x[base];
+        const float* oldY = &oldPositions.y[base];
+        const float* oldZ = &oldPositions.z[base];
+        float* currX = &currPositions.x[base];
+        float* currY = &currPositions.y[base];
+        float* currZ = &currPositions.z[base];
+
+        //Initialization
+        for(int i = 0; i < n; i++) {
+            restPos[i] = glm::vec3(modelMatrix * glm::vec4(restX[i], restY[i], restZ[i], 1.f));
+            newPos[i] = glm::vec3(currX[i], currY[i], currZ[i]);
+        }
+
+        //Integration
+        for(int i = 1; i < n; i++) {
+            glm::vec3 currPos(currX[i], currY[i], currZ[i]);
+            glm::vec3 oldPos(oldX[i], oldY[i], oldZ[i]);
+            glm::vec3 velocity = newPos[i-1] - newPos[i];
+            glm::vec3 force = gravity + glm::cross(glm::cross(velocity, wind), velocity);
+            newPos[i] = currPos + velocityScale * (currPos - oldPos) + force * timeStep2;
+        }
+
+        //Global shape constraints
+        float stiffness = maxStiffness;
+        for(int i = 0; i < n; i++) {
+            newPos[i] += stiffness * (restPos[i] - newPos[i]);
+            stiffness -= maxStiffness / n;
+        }
+
+        //Local shape constraints
+        for(int k = 0; k < parameters.localShapeIterations; k++) {
+            for(int i = 1; i < n; i++) {
+                glm::vec3 correction = 0.5f * localStiffness * (restPos[i] - newPos[i]);
+                newPos[i-1] -= correction;
+                newPos[i] += correction;
+            }
+        }
+
+        //Length constraints
+        if(parameters.lengthConstraintMode == HAIR_LENGTH_FTL) {
+            for(int i = 1; i < n; i++) {
+                glm::vec3 delta = newPos[i] - newPos[i-1];
+                glm::vec3 position = newPos[i-1] + strandLength / std::sqrt(glm::dot(delta, delta) + hairFtlEpsilon) * delta;
+                glm::vec3 correction = position - newPos[i];
+                newPos[i] = position;
+                currX[i-1] += ftlDamping * correction.x;
+                currY[i-1] += ftlDamping * correction.y;
+                currZ[i-1] += ftlDamping * correction.z;
+            }
+        }
+        else {
+            for(int k = 0; k < parameters.lengthConstraintIterations; k++) {
+                for(int i = 0; i < n-1; i++) {
+                    glm::vec3 delta = newPos[i] - newPos[i+1];
+                    float distance = glm::length(delta) - strandLength;
+                    newPos[i] -= 0.5f * distance * delta;
+                    newPos[i+1] += 0.5f * distance * delta;
+                }
+            }
+        }
+
+        float* newX = &newPositions.x[base];
+        float* newY = &newPositions.y[base];
+        float* newZ = &newPositions.z[base];
+        for(int i = 0; i < n; i++) {
+            newX[i] = newPos[i].x;
+            newY[i] = newPos[i].y;
+            newZ[i] = newPos[i].z;
+        }
+    }
+}
+
+void HairSolver::swapBuffers()
+{
+    int oldPrevious = previous;
+    previous = current;
+    current = next;
+    next = oldPrevious;
+}
+
+void HairSolver::getPositions(float* hairData) const
+{
+    const PositionBuffer& currPositions = positions[current];
+    int noOfVertices = noOfMasterHairs * verticesPerStrand;
+    for(int i = 0; i < noOfVertices; i++) {
+        hairData[4*i] = currPositions.x[i];
+        hairData[4*i+1] = currPositions.y[i];
+        hairData[4*i+2] = currPositions.z[i];
+        hairData[4*i+3] = 1.f;
+    }
+}
+
+
+void simulateHairReference(const glm::vec4* restPositions, const glm::vec4* previousPositions,
+                           glm::vec4* currentPositions, glm::vec4* newPositions,
+                           int noOfMasterHairs, int verticesPerStrand,
+                           const HairSolverParameters& parameters)
+{
+    if(!HairSolver::isSupported(verticesPerStrand)) {
+        std::cout << "ERROR::HAIR_SOLVER: " << verticesPerStrand << " vertices per strand, 2 to "
+                  << HairSolver::maxVerticesPerStrand << " are supported" << std::endl;
+        return;
+    }
+    const int n = verticesPerStrand;
+    // same operation order as HairSolver, so that the solvers round alike
+    const float timeStep2 = parameters.timeStep * parameters.timeStep;
+    const glm::vec3 wind = parameters.windMagnitude * getUniformWind(parameters.windDirection);
+    glm::vec4 restPos[HairSolver::maxVerticesPerStrand];
+    glm::vec4 oldPos[HairSolver::maxVerticesPerStrand];
+    glm::vec4 currPos[HairSolver::maxVerticesPerStrand];
+    glm::vec4 newPos[HairSolver::maxVerticesPerStrand];
+
+    for(int strand = 0; strand < noOfMasterHairs; strand++) {
+        const int base = strand * verticesPerStrand;
+        //Initialization
+        for(int i = 0; i < n; i++) {
+            oldPos[i] = previousPositions[base + i];
+            restPos[i] = parameters.modelMatrix * restPositions[base + i];
+            currPos[i] = currentPositions[base + i];
+            newPos[i] = currPos[i];
+        }
+        //Integration
+        glm::vec4 gravityForce = glm::vec4(gravity, 0.f);
+        for(int i = 1; i < n; i++) {
+            glm::vec4 velocity = newPos[i-1] - newPos[i];
+            glm::vec3 v(velocity);
+            glm::vec4 force = gravityForce + glm::vec4(glm::cross(glm::cross(v, wind), v), 0.f);
+            newPos[i] = currPos[i] + (1.0f - parameters.damping) * (currPos[i] - oldPos[i]) + force * timeStep2;
+        }
+        //Global Shape Constraints
+        float S_G = maxStiffness;
+        for(int i = 0; i < n; i++) {
+            newPos[i] = newPos[i] + S_G * (restPos[i] - newPos[i]);
+            S_G = S_G - (maxStiffness / n);
+        }
+        //Local Shape Constraints
+        for(int k = 0; k < parameters.localShapeIterations; k++) {
+            for(int i = 1; i < n; i++) {
+                glm::vec4 correction = 0.5f * localStiffness * (restPos[i] - newPos[i]);
+                newPos[i-1] -= correction;
+                newPos[i] += correction;
+            }
+        }
+        //Length constraints
+        if(parameters.lengthConstraintMode == HAIR_LENGTH_FTL) {
+            for(int i = 1; i < n; i++) {
+                glm::vec4 delta = newPos[i] - newPos[i-1];
+                glm::vec4 position = newPos[i-1] + parameters.hairStrandLength / std::sqrt(glm::dot(delta, delta) + hairFtlEpsilon) * delta;
+                glm::vec4 correction = position - newPos[i];
+                newPos[i] = position;
+                currentPositions[base + i-1] = currPos[i-1] + parameters.ftlDamping * correction;
+            }
+        }
+        else {
+            for(int k = 0; k < parameters.lengthConstraintIterations; k++) {
+                for(int i = 0; i < n-1; i++) {
+                    glm::vec4 delta = newPos[i] - newPos[i+1];
+                    float distance = glm::length(delta) - parameters.hairStrandLength;
+                    newPos[i] -= 0.5f * distance * delta;
+                    newPos[i+1] += 0.5f * distance * delta;
+                }
+            }
+        }
+        for(int i = 0; i < n; i++) {
+            newPositions[base + i] = newPos[i];
+        }
+    }
+}
@@ -0,0 +1,212 @@
+#include "HairSolverSimd.h"
+#include "HairSimdKernel.h"
+#include "StrandScheduler.h"
+
+#include <cmath>
+#include <iostream>
+
+// 4 strands in a plain array, for targets without one of the x86 kernels
+struct SimdLanesGeneric
+{
+    static const int lanes = 4;
+    float v[4];
+
+    static SimdLanesGeneric load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    static SimdLanesGeneric set(float value) { return { { value, value, value, value } }; }
+    void store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+
+    friend SimdLanesGeneric operator+(SimdLanesGeneric a, SimdLanesGeneric b) { return { { a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3] } }; }
+    friend SimdLanesGeneric operator-(SimdLanesGeneric a, SimdLanesGeneric b) { return { { a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3] } }; }
+    friend SimdLanesGeneric operator*(SimdLanesGeneric a, SimdLanesGeneric b) { return { { a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3] } }; }
+    friend SimdLanesGeneric operator/(SimdLanesGeneric a, SimdLanesGeneric b) { return { { a.v[0]/b.v[0], a.v[1]/b.v[1], a.v[2]/b.v[2], a.v[3]/b.v[3] } }; }
+    friend SimdLanesGeneric sqrt(SimdLanesGeneric a) { return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+};
+
+static HairSimdKernel getKernel(HairSimdInstructionSet instructionSet)
+{
+    switch(instructionSet) {
+        case HAIR_SIMD_SSE: return getHairSimdKernelSse();
+        case HAIR_SIMD_AVX2: return getHairSimdKernelAvx2();
+        case HAIR_SIMD_AVX512: return getHairSimdKernelAvx512();
+        default: return simulateHairBlocks<SimdLanesGeneric>;
+    }
+}
+
+bool HairSolverSimd::isSupported(HairSimdInstructionSet instructionSet)
+{
+    if(getKernel(instructionSet) == nullptr)
+        return false;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    switch(instructionSet) {
+        case HAIR_SIMD_SSE: return __builtin_cpu_supports("sse2");
+        case HAIR_SIMD_AVX2: return __builtin_cpu_supports("avx2");
+        case HAIR_SIMD_AVX512: return __builtin_cpu_supports("avx512f");
+        default: return true;
+    }
+#else
+    // Without runtime detection only the baseline kernels are used
+    return instructionSet == HAIR_SIMD_GENERIC || instructionSet == HAIR_SIMD_SSE;
+#endif
+}
+
+HairSimdInstructionSet HairSolverSimd::getBestInstructionSet()
+{
+    if(isSupported(HAIR_SIMD_AVX512))
+        return HAIR_SIMD_AVX512;
+    if(isSupported(HAIR_SIMD_AVX2))
+        return HAIR_SIMD_AVX2;
+    if(isSupported(HAIR_SIMD_SSE))
+        return HAIR_SIMD_SSE;
+    return HAIR_SIMD_GENERIC;
+}
+
+int HairSolverSimd::getLanes(HairSimdInstructionSet instructionSet)
+{
+    switch(instructionSet) {
+        case HAIR_SIMD_AVX2: return 8;
+        case HAIR_SIMD_AVX512: return 16;
+        default: return 4;
+    }
+}
+
+const char* HairSolverSimd::getName(HairSimdInstructionSet instructionSet)
+{
+    switch(instructionSet) {
+        case HAIR_SIMD_SSE: return "sse";
+        case HAIR_SIMD_AVX2: return "avx2";
+        case HAIR_SIMD_AVX512: return "avx512";
+        default: return "generic";
+    }
+}
+
+
+HairSolverSimd::HairSolverSimd(const float* hairData, int noOfMasterHairs, int verticesPerStrand)
+    : noOfMasterHairs(noOfMasterHairs), verticesPerStrand(verticesPerStrand)
+{
+    init(hairData, getBestInstructionSet());
+}
+
+HairSolverSimd::HairSolverSimd(const float* hairData, int noOfMasterHairs, int verticesPerStrand,
+                               HairSimdInstructionSet instructionSet)
+    : noOfMasterHairs(noOfMasterHairs), verticesPerStrand(verticesPerStrand)
+{
+    init(hairData, instructionSet);
+}
+
+void HairSolverSimd::init(const float* hairData, HairSimdInstructionSet requested)
+{
+    if(!HairSolver::isSupported(verticesPerStrand)) {
+        std::cout << "ERROR::HAIR_SOLVER_SIMD: " << verticesPerStrand << " vertices per strand, 2 to "
+                  << HairSolver::maxVerticesPerStrand << " are supported; the solver holds no strands" << std::endl;
+        noOfMasterHairs = 0;
+    }
+    if(!isSupported(requested)) {
+        std::cout << "ERROR::HAIR_SOLVER_SIMD: " << getName(requested) << " is not supported, using "
+                  << getName(getBestInstructionSet()) << std::endl;
+        requested = getBestInstructionSet();
+    }
+    instructionSet = requested;
+    kernel = getKernel(instructionSet);
+    lanes = getLanes(instructionSet);
+    noOfBlocks = (noOfMasterHairs + lanes - 1) / lanes;
+    previous = 0;
+    current = 1;
+    next = 2;
+
+    // Transpose the strands into blocks. Lanes past the last strand are zero,
+    // which keeps them finite through all stages.
+    size_t size = (size_t)noOfBlocks * verticesPerStrand * lanes;
+    for(int c = 0; c < 3; c++)
+        rest[c].assign(size, 0.f);
+    for(int strand = 0; strand < noOfMasterHairs; strand++) {
+        int block = strand / lanes;
+        int lane = strand % lanes;
+        for(int i = 0; i < verticesPerStrand; i++) {
+            size_t index = ((size_t)block * verticesPerStrand + i) * lanes + lane;
+            const float* vertex = &hairData[4 * ((size_t)strand * verticesPerStrand + i)];
+            for(int c = 0; c < 3; c++)
+                rest[c][index] = vertex[c];
+        }
+    }
+    for(int buffer = 0; buffer < 3; buffer++)
+        for(int c = 0; c < 3; c++)
+            positions[buffer][c] = rest[c];
+}
+
+HairSimdBlocks HairSolverSimd::getBlocks()
+{
+    HairSimdBlocks blocks;
+    blocks.noOfBlocks = noOfBlocks;
+    blocks.verticesPerStrand = verticesPerStrand;
+    for(int c = 0; c < 3; c++) {
+        blocks.rest[c] = rest[c].data();
+        blocks.previous[c] = positions[previous][c].data();
+        blocks.current[c] = positions[current][c].data();
+        blocks.next[c] = positions[next][c].data();
+    }
+    return blocks;
+}
+
+HairSimdStep HairSolverSimd::getStep(const HairSolverParameters& parameters)
+{
+    HairSimdStep step;
+    for(int column = 0; column < 4; column++)
+        for(int row = 0; row < 3; row++)
+            step.modelMatrix[column][row] = parameters.modelMatrix[column][row];
+    // Same wind as HairSolver
+    const glm::vec3 wind = parameters.windMagnitude * getUniformWind(parameters.windDirection);
+    for(int c = 0; c < 3; c++)
+        step.wind[c] = wind[c];
+    step.timeStep2 = parameters.timeStep * parameters.timeStep;
+    step.velocityScale = 1.0f - parameters.damping;
+    step.hairStrandLength = parameters.hairStrandLength;
+    step.ftlDamping = parameters.ftlDamping;
+    step.localShapeIterations = parameters.localShapeIterations;
+    step.lengthConstraintIterations = parameters.lengthConstraintIterations;
+    step.lengthConstraintMode = parameters.lengthConstraintMode;
+    return step;
+}
+
+void HairSolverSimd::simulate(const HairSolverParameters& parameters, StrandScheduler* scheduler)
+{
+    if(scheduler != nullptr) {
+        HairSimdBlocks blocks = getBlocks();
+        HairSimdStep step = getStep(parameters);
+        int chunkSize = StrandScheduler::getChunkSize(getBytesPerBlock());
+        scheduler->parallelFor(noOfBlocks, chunkSize, [&](int first, int last, int) {
+            kernel(blocks, first, last, step);
+        });
+    }
+    else {
+        simulateBlocks(0, noOfBlocks, parameters);
+    }
+    swapBuffers();
+}
+
+void HairSolverSimd::simulateBlocks(int firstBlock, int lastBlock, const HairSolverParameters& parameters)
+{
+    kernel(getBlocks(), firstBlock, lastBlock, getStep(parameters));
+}
+
+void HairSolverSimd::swapBuffers()
+{
+    int oldPrevious = previous;
+    previous = current;
+    current = next;
+    next = oldPrevious;
+}
+
+void HairSolverSimd::getPositions(float* hairData) const
+{
+    for(int strand = 0; strand < noOfMasterHairs; strand++) {
+        int block = strand / lanes;
+        int lane = strand % lanes;
+        for(int i = 0; i < verticesPerStrand; i++) {
+            size_t index = ((size_t)block * verticesPerStrand + i) * lanes + lane;
+            float* vertex = &hairData[4 * ((size_t)strand * verticesPerStrand + i)];
+            for(int c = 0; c < 3; c++)
+                vertex[c] = positions[current][c][index];
+            vertex[3] = 1.f;
+        }
+    }
+}
@@ -0,0 +1,242 @@
+#include "HairStateBuffers.h"
+#include "HairAssets.h"
+
+#include <glm.hpp>
+
+#include <cstdio>
+#include <vector>
+
+
+HairStateBuffers::HairStateBuffers(const GLfloat* hairData, int noOfMasterHairs, int verticesPerStrand,
+                                   HairStorageFormat format, const HairAssets* assets)
+    : noOfMasterHairs(noOfMasterHairs), verticesPerStrand(verticesPerStrand), format(format),
+      noOfSlots(NO_OF_SLOTS), writeCount(0), previous(0), current(1), next(2), history(1), pinned(1),
+      latency(HAIR_RENDER_ZERO_LATENCY), renderCurrent(-1), renderPinned(-1)
+{
+    for(int slot = 0; slot < MAX_SLOTS; slot++) {
+        positionBuffers[slot] = 0;
+        positionTextures[slot] = 0;
+        lastWrite[slot] = 0;
+    }
+
+    size_t noOfVertices = (size_t)noOfMasterHairs * verticesPerStrand;
+
+    // The simulation starts at rest, so every slot starts with the rest positions,
+    // placed by the model matrices of the assets if there are any
+    std::vector<GLfloat> placed;
+    if(assets) {
+        placed.resize(4 * noOfVertices);
+        for(size_t i = 0; i < noOfVertices; i++) {
+            const glm::mat4& modelMatrix = assets->getParameters(assets->getAsset((int)(i / verticesPerStrand))).modelMatrix;
+            glm::vec4 position = modelMatrix * glm::vec4(hairData[4*i], hairData[4*i+1], hairData[4*i+2], hairData[4*i+3]);
+            for(int k = 0; k < 4; k++)
+                placed[4*i+k] = position[k];
+        }
+    }
+
+    // fp16: pack xy and zw into one uint each, like packHalf2x16 in the shaders
+    std::vector<GLuint> packedRest, packedPlaced;
+    auto pack = [&](const GLfloat* positions, std::vector<GLuint>& packed) -> const void* {
+        if(format != HAIR_STORAGE_FP16)
+            return positions;
+        packed.resize(2 * noOfVertices);
+        for(size_t i = 0; i < noOfVertices; i++) {
+            packed[2*i] = glm::packHalf2x16(glm::vec2(positions[4*i], positions[4*i+1]));
+            packed[2*i+1] = glm::packHalf2x16(glm::vec2(positions[4*i+2], positions[4*i+3]));
+        }
+        return packed.data();
+    };
+    const void* restData = pack(hairData, packedRest);
+    const void* positionData = assets ? pack(placed.data(), packedPlaced) : restData;
+
+    glGenBuffers(1, &restBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, restBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, getBufferSize(), restData, GL_STATIC_DRAW);
+
+    glGenBuffers(NO_OF_SLOTS, positionBuffers);
+    glGenTextures(NO_OF_SLOTS, positionTextures);
+    for(int i = 0; i < NO_OF_SLOTS; i++) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, positionBuffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, getBufferSize(), positionData, GL_DYNAMIC_COPY);
+
+        glBindTexture(GL_TEXTURE_BUFFER, positionTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, format == HAIR_STORAGE_FP16 ? GL_RGBA16F : GL_RGBA32F, positionBuffers[i]);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+HairStateBuffers::~HairStateBuffers()
+{
+    glDeleteTextures(noOfSlots, positionTextures);
+    glDeleteBuffers(noOfSlots, positionBuffers);
+    glDeleteBuffers(1, &restBuffer);
+}
+
+int HairStateBuffers::getFreeSlot(int a, int b, int c, int d, int e) const
+{
+    int free = -1;
+    for(int slot = 0; slot < noOfSlots; slot++)
+        if(slot != a && slot != b && slot != c && slot != d && slot != e &&
+           (free < 0 || lastWrite[slot] < lastWrite[free]))
+            free = slot;
+    return free;
+}
+
+void HairStateBuffers::bindForSimulation(bool correctsHistory)
+{
+    // Four slots always leave one for next: previous, current and pinned take at
+    // most three. The history is corrected in place unless the current slot is
+    // pinned, which is only the case in the first substep, when the previous slot
+    // is not pinned and a fourth slot is still free. The two render slots come on
+    // top, with the two extra slots of one frame of latency.
+    next = getFreeSlot(previous, current, pinned, renderCurrent, renderPinned);
+    history = correctsHistory && current == pinned ?
+              getFreeSlot(previous, current, next, renderCurrent, renderPinned) : current;
+    lastWrite[next] = lastWrite[history] = ++writeCount;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, restBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, positionBuffers[previous]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, positionBuffers[current]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, positionBuffers[next]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, positionBuffers[history]);
+}
+
+void HairStateBuffers::swapBuffers()
+{
+    previous = history;
+    current = next;
+    history = current;
+}
+
+void HairStateBuffers::pinRenderState()
+{
+    pinned = current;
+}
+
+void HairStateBuffers::bindForRendering(int textureUnit, int pinnedTextureUnit)
+{
+    GLuint currentTexture = positionTextures[current];
+    GLuint pinnedTexture = positionTextures[pinned];
+    if(latency == HAIR_RENDER_ONE_FRAME_LATENCY && renderCurrent >= 0) {
+        currentTexture = positionTextures[renderCurrent];
+        pinnedTexture = positionTextures[renderPinned];
+    }
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, currentTexture);
+    glActiveTexture(GL_TEXTURE0 + pinnedTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, pinnedTexture);
+}
+
+void HairStateBuffers::setRenderLatency(HairRenderLatency latency)
+{
+    if(latency == this->latency)
+        return;
+    this->latency = latency;
+    renderCurrent = renderPinned = -1;
+    if(latency != HAIR_RENDER_ONE_FRAME_LATENCY || noOfSlots == MAX_SLOTS)
+        return;
+
+    // The extra slots start as copies of the current one, which holds the settled
+    // positions of the sleeping strands like every other slot
+    glGenBuffers(NO_OF_RENDER_SLOTS, positionBuffers + NO_OF_SLOTS);
+    glGenTextures(NO_OF_RENDER_SLOTS, positionTextures + NO_OF_SLOTS);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, positionBuffers[current]);
+    for(int slot = NO_OF_SLOTS; slot < MAX_SLOTS; slot++) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, positionBuffers[slot]);
+        glBufferData(GL_COPY_WRITE_BUFFER, getBufferSize(), NULL, GL_DYNAMIC_COPY);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, getBufferSize());
+
+        glBindTexture(GL_TEXTURE_BUFFER, positionTextures[slot]);
+        glTexBuffer(GL_TEXTURE_BUFFER, format == HAIR_STORAGE_FP16 ? GL_RGBA16F : GL_RGBA32F, positionBuffers[slot]);
+        lastWrite[slot] = lastWrite[current];
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    noOfSlots = MAX_SLOTS;
+}
+
+void HairStateBuffers::presentRenderState()
+{
+    if(latency != HAIR_RENDER_ONE_FRAME_LATENCY)
+        return;
+
+    // the next draw fetches what the kernels wrote as storage buffers
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    renderCurrent = current;
+    renderPinned = pinned;
+}
+
+void HairStateBuffers::getPositions(GLfloat* hairData) const
+{
+    size_t noOfVertices = (size_t)noOfMasterHairs * verticesPerStrand;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, positionBuffers[current]);
+    if(format == HAIR_STORAGE_FP16) {
+        std::vector<GLuint> packed(2 * noOfVertices);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, getBufferSize(), packed.data());
+        for(size_t i = 0; i < noOfVertices; i++) {
+            glm::vec2 xy = glm::unpackHalf2x16(packed[2*i]);
+            glm::vec2 zw = glm::unpackHalf2x16(packed[2*i+1]);
+            hairData[4*i] = xy.x;
+            hairData[4*i+1] = xy.y;
+            hairData[4*i+2] = zw.x;
+            hairData[4*i+3] = zw.y;
+        }
+    }
+    else
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, getBufferSize(), hairData);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+size_t HairStateBuffers::getBufferSize(HairStorageFormat format) const
+{
+    return (size_t)noOfMasterHairs * verticesPerStrand * getBytesPerVertex(format);
+}
+
+size_t HairStateBuffers::getMemoryFootprint(HairStorageFormat format) const
+{
+    return (1 + noOfSlots) * getBufferSize(format);
+}
+
+size_t HairStateBuffers::getSimulationBytesPerDispatch(HairStorageFormat format, bool correctsHistory) const
+{
+    // rest, previous and current are read, next is written, and so is history when
+    // the dispatch corrects it
+    return (correctsHistory ? 5 : 4) * getBufferSize(format);
+}
+
+void HairStateBuffers::printMemoryReport(std::ostream& out) const
+{
+    const double MiB = 1024.0 * 1024.0;
+    char line[256];
+    snprintf(line, sizeof(line), "Hair state: %d strands x %d vertices in %d buffers (rest and %d slots), * in use\n"
+                                 "  format  bytes per vertex  footprint [MiB]  per dispatch [MiB]  with history [MiB]\n",
+             noOfMasterHairs, verticesPerStrand, 1 + noOfSlots, noOfSlots);
+    out << line;
+    for(HairStorageFormat rowFormat : {HAIR_STORAGE_FP32, HAIR_STORAGE_FP16}) {
+        snprintf(line, sizeof(line), "  %s%c   %16zu  %15.2f  %18.2f  %18.2f\n",
+                 getName(rowFormat), rowFormat == format ? '*' : ' ', getBytesPerVertex(rowFormat),
+                 getMemoryFootprint(rowFormat) / MiB, getSimulationBytesPerDispatch(rowFormat, false) / MiB,
+                 getSimulationBytesPerDispatch(rowFormat, true) / MiB);
+        out << line;
+    }
+}
+
+std::string HairStateBuffers::getShaderDefines(HairStorageFormat format)
+{
+    return format == HAIR_STORAGE_FP16 ? "#define HAIR_STATE_FP16\n" : "";
+}
+
+const char* HairStateBuffers::getName(HairStorageFormat format)
+{
+    return format == HAIR_STORAGE_FP16 ? "fp16" : "fp32";
+}
+
+size_t HairStateBuffers::getBytesPerVertex(HairStorageFormat format)
+{
+    return format == HAIR_STORAGE_FP16 ? 4 * sizeof(GLushort) : 4 * sizeof(GLfloat);
+}
@@ -0,0 +1,96 @@
+#include "HairVolume.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include <gtc/matrix_transform.hpp>
+
+
+HairVolume::HairVolume(const GLfloat* hairData, int noOfMasterHairs, int verticesPerStrand, int maxResolution, float padding,
+                       int noOfSlabs)
+    : noOfVertices(noOfMasterHairs * verticesPerStrand), noOfSlabs(std::max(noOfSlabs, 1))
+{
+    glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+    for(int i = 0; i < noOfVertices; i++) {
+        glm::vec3 position(hairData[4*i], hairData[4*i+1], hairData[4*i+2]);
+        lower = glm::min(lower, position);
+        upper = glm::max(upper, position);
+    }
+    if(noOfVertices == 0)
+        lower = upper = glm::vec3(0.f);
+
+    glm::vec3 extent = upper - lower + 2.f * padding;
+    cellSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, FLT_MIN)) / std::max(maxResolution, 2);
+    resolution = glm::max(glm::ivec3(glm::ceil(extent / cellSize)), glm::ivec3(2));
+    glm::vec3 origin = 0.5f * (lower + upper) - 0.5f * cellSize * glm::vec3(resolution);
+    textureMatrix = glm::scale(glm::mat4(1.f), 1.f / (cellSize * glm::vec3(resolution))) *
+                    glm::translate(glm::mat4(1.f), -origin);
+
+    int noOfCells = resolution.x * resolution.y * resolution.z * this->noOfSlabs;
+    glGenBuffers(1, &cellBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cellBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, noOfCells * 4 * sizeof(GLint), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLuint* textures[] = {&volumeTexture, &gradientTexture};
+    for(GLuint* texture : textures) {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_3D, *texture);
+        glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA32F, resolution.x, resolution.y, resolution.z * this->noOfSlabs);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+HairVolume::~HairVolume()
+{
+    glDeleteTextures(1, &gradientTexture);
+    glDeleteTextures(1, &volumeTexture);
+    glDeleteBuffers(1, &cellBuffer);
+}
+
+void HairVolume::dispatchSplat(ComputeShader& splatShader) const
+{
+    GLint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, cellBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32I, GL_RED_INTEGER, GL_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, cellBuffer);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // object space to cell coordinates, cell centers at integer + 0.5
+    glm::mat4 objectToCells = glm::scale(glm::mat4(1.f), glm::vec3(resolution)) * textureMatrix;
+    splatShader.use();
+    splatShader.setMat4("objectToCells", objectToCells);
+    splatShader.setInt("noOfVertices", noOfVertices);
+    glUniform3i(glGetUniformLocation(splatShader.ID, "resolution"), resolution.x, resolution.y, resolution.z);
+    glDispatchCompute((noOfVertices + splatGroupSize - 1) / splatGroupSize, 1, 1);
+}
+
+void HairVolume::dispatchResolve(ComputeShader& resolveShader, float restDensity) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, cellBuffer);
+    glBindImageTexture(0, volumeTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, gradientTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    resolveShader.use();
+    resolveShader.setFloat("cellSize", cellSize);
+    resolveShader.setFloat("restDensity", restDensity);
+    resolveShader.setInt("noOfSlabs", noOfSlabs);
+    glUniform3i(glGetUniformLocation(resolveShader.ID, "resolution"), resolution.x, resolution.y, resolution.z);
+    glDispatchCompute((resolution.x + resolveGroupSize - 1) / resolveGroupSize,
+                      (resolution.y + resolveGroupSize - 1) / resolveGroupSize,
+                      (resolution.z * noOfSlabs + resolveGroupSize - 1) / resolveGroupSize);
+}
+
+void HairVolume::bindForSimulation(int volumeTextureUnit, int gradientTextureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + volumeTextureUnit);
+    glBindTexture(GL_TEXTURE_3D, volumeTexture);
+    glActiveTexture(GL_TEXTURE0 + gradientTextureUnit);
+    glBindTexture(GL_TEXTURE_3D, gradientTexture);
+}
@@ -0,0 +1,119 @@
+#include "HeadlessContext.h"
+#include "LoadTGA.h"
+
+#ifdef HAIR_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+#include <iostream>
+
+
+HeadlessContext::HeadlessContext()
+    : display(nullptr), context(nullptr), width(0), height(0), framebuffer(0),
+      colorRenderbuffer(0), depthRenderbuffer(0), resolveFramebuffer(0), resolveRenderbuffer(0)
+{
+#ifdef HAIR_HEADLESS_EGL
+    // a display without a window system, the default one if the platform is missing
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if(eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        std::cout << "Failed to initialize EGL" << std::endl;
+        return;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    // the same version and profile as the window context, without a config or surface
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+    if(eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        std::cout << "Failed to create a surfaceless OpenGL 4.3 context (EGL " << major << "." << minor << ")" << std::endl;
+        if(eglContext != EGL_NO_CONTEXT)
+            eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+        return;
+    }
+    display = eglDisplay;
+    context = eglContext;
+#else
+    std::cout << "Headless mode is not available, built without EGL" << std::endl;
+#endif
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if(framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteFramebuffers(1, &resolveFramebuffer);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteRenderbuffers(1, &resolveRenderbuffer);
+    }
+#ifdef HAIR_HEADLESS_EGL
+    if(context) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+#endif
+}
+
+void HeadlessContext::createFramebuffer(int width, int height, int samples)
+{
+    this->width = width;
+    this->height = height;
+
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+
+    glGenRenderbuffers(1, &resolveRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, resolveRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &resolveFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveRenderbuffer);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    bindFramebuffer();
+    glViewport(0, 0, width, height);
+}
+
+void HeadlessContext::bindFramebuffer() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void HeadlessContext::saveFrame(const char* filename) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer);
+    SaveFramebufferToTGA(filename, 0, 0, width, height);
+    bindFramebuffer();
+}
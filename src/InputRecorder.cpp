@@ -0,0 +1,258 @@
+#include "InputRecorder.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+template <class T>
+void write(std::ofstream& out, T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+bool read(std::ifstream& in, T& value)
+{
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+// The parameters are stored as 22 floats
+const int floatsPerParameters = 3 + 1 + 16 + 1 + 1;
+
+void packParameters(const InputParameters& parameters, float* values)
+{
+    for(int i = 0; i < 3; i++)
+        values[i] = parameters.cameraPosition[i];
+    values[3] = parameters.cameraZoom;
+    for(int column = 0; column < 4; column++)
+        for(int row = 0; row < 4; row++)
+            values[4 + 4 * column + row] = parameters.model[column][row];
+    values[20] = parameters.windAmount;
+    values[21] = parameters.hairStrandLength;
+}
+
+void unpackParameters(const float* values, InputParameters& parameters)
+{
+    for(int i = 0; i < 3; i++)
+        parameters.cameraPosition[i] = values[i];
+    parameters.cameraZoom = values[3];
+    for(int column = 0; column < 4; column++)
+        for(int row = 0; row < 4; row++)
+            parameters.model[column][row] = values[4 + 4 * column + row];
+    parameters.windAmount = values[20];
+    parameters.hairStrandLength = values[21];
+}
+
+}
+
+InputRecorder::InputRecorder()
+    : mode(INPUT_LIVE), frameSeconds(0.f), fixedFrameSeconds(0.f), startSeconds(0.0), time(0.0), deltaTime(0.f),
+      frame(0), finished(false)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+void InputRecorder::close()
+{
+    if(recording.is_open())
+        recording.close();
+    if(replay.is_open())
+        replay.close();
+}
+
+bool InputRecorder::startRecording(const std::string& path)
+{
+    close();
+    mode = INPUT_LIVE;
+    recording.open(path, std::ios::binary | std::ios::trunc);
+    if(!recording) {
+        std::cout << "Failed to open input recording " << path << std::endl;
+        return false;
+    }
+    write(recording, magic);
+    write(recording, version);
+
+    mode = INPUT_RECORD;
+    frame = 0;
+    finished = false;
+    frameEvents.clear();
+    keyStates.clear();
+    return true;
+}
+
+bool InputRecorder::startReplay(const std::string& path, float frameSeconds)
+{
+    close();
+    mode = INPUT_LIVE;
+    replay.open(path, std::ios::binary);
+    uint32_t fileMagic = 0, fileVersion = 0;
+    if(!replay || !read(replay, fileMagic) || !read(replay, fileVersion) || fileMagic != magic || fileVersion != version) {
+        std::cout << "Failed to open input replay " << path << ", not an input recording of version " << version << std::endl;
+        replay.close();
+        return false;
+    }
+
+    mode = INPUT_REPLAY;
+    this->frameSeconds = frameSeconds;
+    time = 0.0;
+    frame = 0;
+    finished = false;
+    frameEvents.clear();
+    keysDown.clear();
+    return true;
+}
+
+float InputRecorder::beginFrame(double wallSeconds)
+{
+    if(mode != INPUT_REPLAY) {
+        if(fixedFrameSeconds > 0.f) {
+            deltaTime = fixedFrameSeconds;
+            time = frame * (double)fixedFrameSeconds;
+            startSeconds = 0.0;
+        }
+        else {
+            // the clock starts at the first frame, which has no frame time yet
+            if(frame == 0)
+                time = startSeconds = wallSeconds;
+            deltaTime = float(wallSeconds - time);
+            time = wallSeconds;
+        }
+        frame++;
+        return deltaTime;
+    }
+
+    // the time of the first frame is 0, like the simulation clock expects
+    if(!readFrame()) {
+        finished = true;
+        frameEvents.clear();
+        return frameSeconds;
+    }
+    if(frame > 0)
+        time += frameSeconds;
+    frame++;
+    return frameSeconds;
+}
+
+bool InputRecorder::readFrame()
+{
+    float recordedDeltaTime;
+    uint16_t noOfEvents;
+    if(!read(replay, recordedDeltaTime) || !read(replay, noOfEvents))
+        return false;
+
+    frameEvents.clear();
+    for(int i = 0; i < noOfEvents; i++) {
+        uint8_t type;
+        InputEvent event = {};
+        if(!read(replay, type) || !read(replay, event.time))
+            return false;
+        event.type = (InputEventType)type;
+        if(event.type == INPUT_KEY) {
+            int16_t key;
+            uint8_t down;
+            if(!read(replay, key) || !read(replay, down))
+                return false;
+            std::vector<int>::iterator position = std::find(keysDown.begin(), keysDown.end(), (int)key);
+            if(down && position == keysDown.end())
+                keysDown.push_back(key);
+            else if(!down && position != keysDown.end())
+                keysDown.erase(position);
+            continue;
+        }
+        if((event.type == INPUT_CURSOR && !read(replay, event.x)) || !read(replay, event.y))
+            return false;
+        frameEvents.push_back(event);
+    }
+
+    float values[floatsPerParameters];
+    if(!replay.read(reinterpret_cast<char*>(values), sizeof(values)))
+        return false;
+    unpackParameters(values, replayParameters);
+    return true;
+}
+
+bool InputRecorder::isKeyDown(GLFWwindow* window, int key)
+{
+    if(mode == INPUT_REPLAY)
+        return std::find(keysDown.begin(), keysDown.end(), key) != keysDown.end();
+
+    bool down = window && glfwGetKey(window, key) == GLFW_PRESS;
+    if(mode == INPUT_RECORD) {
+        std::vector<std::pair<int, bool> >::iterator state = keyStates.begin();
+        while(state != keyStates.end() && state->first != key)
+            ++state;
+        // every key starts up, the first poll only logs a pressed one
+        if(state == keyStates.end()) {
+            keyStates.push_back(std::make_pair(key, false));
+            state = keyStates.end() - 1;
+        }
+        if(state->second != down) {
+            state->second = down;
+            InputEvent event = {INPUT_KEY, key, down ? 1.0 : 0.0, 0.0, getEventTime(time)};
+            frameEvents.push_back(event);
+        }
+    }
+    return down;
+}
+
+void InputRecorder::recordCursor(double x, double y, double wallSeconds)
+{
+    if(mode != INPUT_RECORD)
+        return;
+    InputEvent event = {INPUT_CURSOR, 0, x, y, getEventTime(wallSeconds)};
+    frameEvents.push_back(event);
+}
+
+void InputRecorder::recordScroll(double y, double wallSeconds)
+{
+    if(mode != INPUT_RECORD)
+        return;
+    InputEvent event = {INPUT_SCROLL, 0, 0.0, y, getEventTime(wallSeconds)};
+    frameEvents.push_back(event);
+}
+
+float InputRecorder::getEventTime(double wallSeconds) const
+{
+    // fixed frame times run on a clock of their own, events get the frame's time there
+    return float((fixedFrameSeconds > 0.f ? time : wallSeconds) - startSeconds);
+}
+
+void InputRecorder::endInput(InputParameters& parameters)
+{
+    if(mode == INPUT_REPLAY) {
+        if(!finished)
+            parameters = replayParameters;
+        return;
+    }
+    if(mode != INPUT_RECORD)
+        return;
+
+    write(recording, deltaTime);
+    write(recording, (uint16_t)std::min<size_t>(frameEvents.size(), 0xffff));
+    for(size_t i = 0; i < frameEvents.size() && i < 0xffff; i++) {
+        const InputEvent& event = frameEvents[i];
+        write(recording, (uint8_t)event.type);
+        write(recording, event.time);
+        if(event.type == INPUT_KEY) {
+            write(recording, (int16_t)event.key);
+            write(recording, (uint8_t)(event.x != 0.0));
+        }
+        else {
+            if(event.type == INPUT_CURSOR)
+                write(recording, event.x);
+            write(recording, event.y);
+        }
+    }
+    frameEvents.clear();
+
+    float values[floatsPerParameters];
+    packParameters(parameters, values);
+    recording.write(reinterpret_cast<const char*>(values), sizeof(values));
+}
@@ -313,9 +313,8 @@ int SaveDataToTGA(const char			*filename,
 		imageData[i+2] = aux;
 	}
 
-// save the image data
-	w = 1;
-	while (w < width) w = w << 1;
+// save the image data, rows are tightly packed like the loader stores them
+	w = width;
 //	bytesPerPixel = pixelDepth/8;	
 //	row = width * bytesPerPixel;
 	
@@ -346,10 +345,11 @@ void SaveFramebufferToTGA(const char *filename, GLint x, GLint y, GLint w, GLint
 {
 	int err;
 	void *buffer = malloc(h*w*3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
 	glReadPixels(x, y, w, h, GL_RGB, GL_UNSIGNED_BYTE, buffer);
 	err = SaveDataToTGA(filename, w, h, 
 			3*8, (unsigned char *)buffer);
-//	free(buffer); already done
+	free(buffer); // SaveDataToTGA leaves it to the host
 	printf("SaveDataToTGA returned %d\n", err);
 }
 
@@ -0,0 +1,107 @@
+#include "PipelineStatistics.h"
+
+#include <cstdio>
+
+namespace {
+
+const GLenum counterTargets[PipelineStatistics::NO_OF_COUNTERS] = {
+    GL_TESS_CONTROL_SHADER_PATCHES_ARB,
+    GL_TESS_EVALUATION_SHADER_INVOCATIONS_ARB,
+    GL_GEOMETRY_SHADER_INVOCATIONS,
+    GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED_ARB,
+    GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+};
+
+}
+
+PipelineStatistics::PipelineStatistics()
+    : supported(GLEW_ARB_pipeline_statistics_query), currentFrame(0), running(false), measuredFrames(0)
+{
+    for(int frame = 0; frame < framesInFlight; frame++)
+        pending[frame] = false;
+    for(int counter = 0; counter < NO_OF_COUNTERS; counter++)
+        counters[counter] = 0;
+    if(supported)
+        glGenQueries(framesInFlight * NO_OF_COUNTERS, &queries[0][0]);
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+    if(supported)
+        glDeleteQueries(framesInFlight * NO_OF_COUNTERS, &queries[0][0]);
+}
+
+void PipelineStatistics::begin()
+{
+    if(!supported || running)
+        return;
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    if(pending[currentFrame])
+        collect(currentFrame);
+
+    // queries of different targets may be active at the same time
+    for(int counter = 0; counter < NO_OF_COUNTERS; counter++)
+        glBeginQuery(counterTargets[counter], queries[currentFrame][counter]);
+    running = true;
+}
+
+void PipelineStatistics::end()
+{
+    if(!running)
+        return;
+    for(int counter = 0; counter < NO_OF_COUNTERS; counter++)
+        glEndQuery(counterTargets[counter]);
+    pending[currentFrame] = true;
+    running = false;
+}
+
+void PipelineStatistics::collect(int frame)
+{
+    pending[frame] = false;
+    GLint available = 0;
+    glGetQueryObjectiv(queries[frame][NO_OF_COUNTERS - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+        return;
+    for(int counter = 0; counter < NO_OF_COUNTERS; counter++)
+        glGetQueryObjectui64v(queries[frame][counter], GL_QUERY_RESULT, &counters[counter]);
+    measuredFrames++;
+}
+
+const char* PipelineStatistics::getName(Counter counter)
+{
+    switch(counter) {
+    case TESS_CONTROL_PATCHES:        return "tess control patches";
+    case TESS_EVALUATION_INVOCATIONS: return "tess evaluation invocations";
+    case GEOMETRY_INVOCATIONS:        return "geometry invocations";
+    case GEOMETRY_PRIMITIVES_EMITTED: return "geometry primitives emitted";
+    case CLIPPING_INPUT_PRIMITIVES:   return "clipping input primitives";
+    case CLIPPING_OUTPUT_PRIMITIVES:  return "clipping output primitives";
+    case FRAGMENT_INVOCATIONS:        return "fragment invocations";
+    default:                          return "";
+    }
+}
+
+void PipelineStatistics::print(std::ostream& out, int noOfStrands, int verticesPerStrand) const
+{
+    if(!supported) {
+        out << "Hair draw pipeline statistics: ARB_pipeline_statistics_query is not supported" << std::endl;
+        return;
+    }
+    if(!hasResults()) {
+        out << "Hair draw pipeline statistics: no frame read back yet" << std::endl;
+        return;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line), "Hair draw pipeline statistics: %d total strands, %d total vertices\n",
+             noOfStrands, noOfStrands * verticesPerStrand);
+    out << line;
+    for(int counter = 0; counter < NO_OF_COUNTERS; counter++) {
+        double perStrand = noOfStrands > 0 ? (double)counters[counter] / noOfStrands : 0.0;
+        snprintf(line, sizeof(line), "  %-30s %14llu  %12.2f per strand\n", getName((Counter)counter),
+                 (unsigned long long)counters[counter], perStrand);
+        out << line;
+    }
+}
@@ -0,0 +1,273 @@
+#include "SignedDistanceField.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include <gtc/matrix_transform.hpp>
+
+namespace {
+
+// Voxels around a triangle that get their exact distance to it before the propagation
+const int exactBand = 1;
+
+glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    // Voronoi regions of the corners, edges and face (Ericson, Real-Time Collision Detection 5.1.5)
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if(d1 <= 0.f && d2 <= 0.f)
+        return a;
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if(d3 >= 0.f && d4 <= d3)
+        return b;
+    float vc = d1 * d4 - d3 * d2;
+    if(vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+        return a + d1 / (d1 - d3) * ab;
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if(d6 >= 0.f && d5 <= d6)
+        return c;
+    float vb = d5 * d2 - d1 * d6;
+    if(vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+        return a + d2 / (d2 - d6) * ac;
+    float va = d3 * d6 - d5 * d4;
+    if(va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f)
+        return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+    float denominator = 1.f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Orientation of the 2D triangle (origin, p1, p2) with a consistent tie break for
+// collinear points, so a ray through an edge shared by two triangles crosses exactly one
+int orientation(double x1, double y1, double x2, double y2, double& twiceSignedArea)
+{
+    twiceSignedArea = y1 * x2 - x1 * y2;
+    if(twiceSignedArea > 0) return 1;
+    if(twiceSignedArea < 0) return -1;
+    if(y2 > y1) return 1;
+    if(y2 < y1) return -1;
+    if(x1 > x2) return 1;
+    if(x1 < x2) return -1;
+    return 0;
+}
+
+// Whether (x0, y0) lies in the 2D triangle p1 p2 p3, with its barycentric coordinates
+bool pointInTriangle(double x0, double y0, double x1, double y1, double x2, double y2, double x3, double y3,
+                     double& a, double& b, double& c)
+{
+    x1 -= x0; x2 -= x0; x3 -= x0;
+    y1 -= y0; y2 -= y0; y3 -= y0;
+    int signA = orientation(x2, y2, x3, y3, a);
+    if(signA == 0)
+        return false;
+    int signB = orientation(x3, y3, x1, y1, b);
+    if(signB != signA)
+        return false;
+    int signC = orientation(x1, y1, x2, y2, c);
+    if(signC != signA)
+        return false;
+    double sum = a + b + c;
+    if(sum == 0)
+        return false;
+    a /= sum;
+    b /= sum;
+    c /= sum;
+    return true;
+}
+
+}
+
+SignedDistanceField::SignedDistanceField(const GLfloat* positions, int stride, const GLuint* indices, int noOfTriangles,
+                                         int maxResolution, float padding, StrandScheduler& scheduler)
+{
+    auto start = std::chrono::steady_clock::now();
+    bake(positions, stride, indices, noOfTriangles, std::max(maxResolution, 2), padding, scheduler);
+    bakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // rgb: outward direction, a: signed distance
+    int noOfVoxels = (int)distances.size();
+    std::vector<GLfloat> texels(4 * noOfVoxels);
+    scheduler.parallelFor(resolution.z, 1, [&](int first, int last, int) {
+        for(int k = first; k < last; k++)
+            for(int j = 0; j < resolution.y; j++)
+                for(int i = 0; i < resolution.x; i++) {
+                    int voxel = voxelIndex(i, j, k);
+                    glm::vec3 direction(0.f);
+                    if(closestTriangles[voxel] >= 0) {
+                        const glm::vec3* triangle = &triangles[3 * closestTriangles[voxel]];
+                        glm::vec3 p = voxelCenter(i, j, k);
+                        glm::vec3 away = p - closestPointOnTriangle(p, triangle[0], triangle[1], triangle[2]);
+                        float length = glm::length(away);
+                        if(length > 0.f)
+                            direction = (distances[voxel] < 0.f ? -away : away) / length;
+                    }
+                    texels[4*voxel] = direction.x;
+                    texels[4*voxel+1] = direction.y;
+                    texels[4*voxel+2] = direction.z;
+                    texels[4*voxel+3] = distances[voxel];
+                }
+    });
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, resolution.x, resolution.y, resolution.z, 0,
+                 GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // outside the padded box the border voxels are far enough from the surface
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+SignedDistanceField::~SignedDistanceField()
+{
+    glDeleteTextures(1, &texture);
+}
+
+void SignedDistanceField::bake(const GLfloat* positions, int stride, const GLuint* indices, int noOfTriangles,
+                               int maxResolution, float padding, StrandScheduler& scheduler)
+{
+    // Degenerate triangles have no closest point of their own and no inside
+    glm::vec3 lower(FLT_MAX), upper(-FLT_MAX);
+    for(int t = 0; t < noOfTriangles; t++) {
+        glm::vec3 corners[3];
+        for(int c = 0; c < 3; c++) {
+            const GLfloat* position = positions + (size_t)stride * indices[3*t + c];
+            corners[c] = glm::vec3(position[0], position[1], position[2]);
+        }
+        if(glm::length(glm::cross(corners[1] - corners[0], corners[2] - corners[0])) == 0.f)
+            continue;
+        for(int c = 0; c < 3; c++) {
+            triangles.push_back(corners[c]);
+            lower = glm::min(lower, corners[c]);
+            upper = glm::max(upper, corners[c]);
+        }
+    }
+    if(triangles.empty())
+        lower = upper = glm::vec3(0.f);
+
+    glm::vec3 extent = upper - lower + 2.f * padding;
+    voxelSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, FLT_MIN)) / maxResolution;
+    resolution = glm::max(glm::ivec3(glm::ceil(extent / voxelSize)), glm::ivec3(1));
+    origin = 0.5f * (lower + upper) - 0.5f * voxelSize * glm::vec3(resolution);
+    textureMatrix = glm::scale(glm::mat4(1.f), 1.f / (voxelSize * glm::vec3(resolution))) *
+                    glm::translate(glm::mat4(1.f), -origin);
+
+    int noOfVoxels = resolution.x * resolution.y * resolution.z;
+    distances.assign(noOfVoxels, FLT_MAX);
+    closestTriangles.assign(noOfVoxels, -1);
+
+    // Voxel range of every triangle's bounding box, grown by the exact band
+    int noOfValidTriangles = (int)triangles.size() / 3;
+    std::vector<glm::ivec3> firstVoxels(noOfValidTriangles), lastVoxels(noOfValidTriangles);
+    std::vector<std::vector<int>> slices(resolution.z); // triangles reaching each z slice
+    for(int t = 0; t < noOfValidTriangles; t++) {
+        glm::vec3 triangleLower = glm::min(triangles[3*t], glm::min(triangles[3*t+1], triangles[3*t+2]));
+        glm::vec3 triangleUpper = glm::max(triangles[3*t], glm::max(triangles[3*t+1], triangles[3*t+2]));
+        firstVoxels[t] = glm::clamp(glm::ivec3(glm::floor((triangleLower - origin) / voxelSize - 0.5f)) - exactBand,
+                                    glm::ivec3(0), resolution - 1);
+        lastVoxels[t] = glm::clamp(glm::ivec3(glm::ceil((triangleUpper - origin) / voxelSize - 0.5f)) + exactBand,
+                                   glm::ivec3(0), resolution - 1);
+        for(int k = firstVoxels[t].z; k <= lastVoxels[t].z; k++)
+            slices[k].push_back(t);
+    }
+
+    // 1. Exact distances near the surface, one z slice per work item
+    scheduler.parallelFor(resolution.z, 1, [&](int first, int last, int) {
+        for(int k = first; k < last; k++)
+            for(int t : slices[k])
+                for(int j = firstVoxels[t].y; j <= lastVoxels[t].y; j++)
+                    for(int i = firstVoxels[t].x; i <= lastVoxels[t].x; i++) {
+                        glm::vec3 p = voxelCenter(i, j, k);
+                        float distance = glm::length(p - closestPointOnTriangle(p, triangles[3*t], triangles[3*t+1], triangles[3*t+2]));
+                        int voxel = voxelIndex(i, j, k);
+                        if(distance < distances[voxel]) {
+                            distances[voxel] = distance;
+                            closestTriangles[voxel] = t;
+                        }
+                    }
+    });
+
+    // 2. Nearest triangles of the neighbours, twice along every axis
+    for(int round = 0; round < 2; round++)
+        for(int axis = 0; axis < 3; axis++)
+            propagate(axis, scheduler);
+
+    // 3. Sign: a voxel is inside if a ray from it towards -x crosses the surface an
+    // odd number of times
+    scheduler.parallelFor(resolution.z, 1, [&](int first, int last, int) {
+        std::vector<int> crossings(resolution.x * resolution.y);
+        for(int k = first; k < last; k++) {
+            std::fill(crossings.begin(), crossings.end(), 0);
+            double z = voxelCenter(0, 0, k).z;
+            for(int t : slices[k]) {
+                const glm::vec3* triangle = &triangles[3*t];
+                for(int j = firstVoxels[t].y; j <= lastVoxels[t].y; j++) {
+                    double y = voxelCenter(0, j, 0).y;
+                    double a, b, c;
+                    if(!pointInTriangle(y, z, triangle[0].y, triangle[0].z, triangle[1].y, triangle[1].z,
+                                        triangle[2].y, triangle[2].z, a, b, c))
+                        continue;
+                    double x = a * triangle[0].x + b * triangle[1].x + c * triangle[2].x;
+                    // first voxel whose center lies beyond the crossing
+                    int i = (int)std::ceil((x - origin.x) / voxelSize - 0.5);
+                    if(i < resolution.x)
+                        crossings[j * resolution.x + std::max(i, 0)]++;
+                }
+            }
+            for(int j = 0; j < resolution.y; j++) {
+                int count = 0;
+                for(int i = 0; i < resolution.x; i++) {
+                    count += crossings[j * resolution.x + i];
+                    if(count % 2 == 1)
+                        distances[voxelIndex(i, j, k)] = -distances[voxelIndex(i, j, k)];
+                }
+            }
+        }
+    });
+}
+
+void SignedDistanceField::propagate(int axis, StrandScheduler& scheduler)
+{
+    // Rows along axis are independent; each is swept forward and backward
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    int length = resolution[axis];
+    int noOfRows = resolution[u] * resolution[v];
+    int chunkSize = StrandScheduler::getChunkSize(length * (sizeof(float) + sizeof(int)));
+    scheduler.parallelFor(noOfRows, chunkSize, [&](int first, int last, int) {
+        for(int row = first; row < last; row++) {
+            glm::ivec3 voxel(0);
+            voxel[u] = row % resolution[u];
+            voxel[v] = row / resolution[u];
+            for(int direction = 1; direction >= -1; direction -= 2) {
+                int previous = -1;
+                for(int n = 0; n < length; n++) {
+                    voxel[axis] = direction > 0 ? n : length - 1 - n;
+                    int index = voxelIndex(voxel.x, voxel.y, voxel.z);
+                    int t = previous;
+                    previous = closestTriangles[index];
+                    if(t < 0 || t == closestTriangles[index])
+                        continue;
+                    glm::vec3 p = voxelCenter(voxel.x, voxel.y, voxel.z);
+                    float distance = glm::length(p - closestPointOnTriangle(p, triangles[3*t], triangles[3*t+1], triangles[3*t+2]));
+                    if(distance < distances[index]) {
+                        distances[index] = distance;
+                        closestTriangles[index] = t;
+                        previous = t;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void SignedDistanceField::bind(int textureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+}
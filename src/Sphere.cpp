@@ -1,4 +1,5 @@
 #include "Sphere.h"
+#include "CpuProfiler.h"
 
 
 // Destructor: clean up allocated data
@@ -36,6 +37,7 @@ Sphere::~Sphere() {
 // Author: Stefan Gustavson (stegu@itn.liu.se) 2014.
 // This code is in the public domain.
 Sphere::Sphere(float radius, int segments) {
+    CPU_PROFILE_ZONE("Sphere");
 
     int i, j, base, i0;
     float x, y, z, R;
@@ -0,0 +1,185 @@
+#include "StrandScheduler.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+StrandScheduler::StrandScheduler(int noOfWorkers)
+    : job(nullptr), jobGeneration(0), workersInJob(0), quit(false), elapsedSeconds(0.0)
+{
+    if(noOfWorkers <= 0)
+        noOfWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+    for(int i = 0; i < noOfWorkers; i++)
+        workers.push_back(new Worker());
+    // worker 0 is the thread calling parallelFor()
+    for(int i = 1; i < noOfWorkers; i++)
+        threads.emplace_back(&StrandScheduler::workerLoop, this, i);
+}
+
+StrandScheduler::~StrandScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        quit = true;
+    }
+    jobStarted.notify_all();
+    for(std::thread& thread : threads)
+        thread.join();
+    for(Worker* worker : workers)
+        delete worker;
+}
+
+int StrandScheduler::getChunkSize(size_t bytesPerItem, size_t cacheBytes)
+{
+    if(bytesPerItem == 0)
+        return 1;
+    return (int)std::max<size_t>(1, cacheBytes / bytesPerItem);
+}
+
+void StrandScheduler::parallelFor(int count, int chunkSize, const std::function<void(int, int, int)>& work)
+{
+    if(count <= 0)
+        return;
+    auto start = std::chrono::steady_clock::now();
+
+    // Every worker gets a contiguous run of chunks, so neighbouring strands stay
+    // on the same core unless they are stolen
+    chunkSize = std::max(1, chunkSize);
+    int noOfChunks = (count + chunkSize - 1) / chunkSize;
+    int noOfWorkers = (int)workers.size();
+    for(int w = 0; w < noOfWorkers; w++) {
+        Worker& worker = *workers[w];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.chunks.clear();
+        int firstChunk = (int)((long)noOfChunks * w / noOfWorkers);
+        int lastChunk = (int)((long)noOfChunks * (w + 1) / noOfWorkers);
+        for(int c = firstChunk; c < lastChunk; c++)
+            worker.chunks.push_back({ c * chunkSize, std::min(count, (c + 1) * chunkSize) });
+    }
+
+    if(noOfWorkers > 1) {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            job = &work;
+            jobGeneration++;
+            workersInJob = noOfWorkers - 1;
+        }
+        jobStarted.notify_all();
+    }
+    else {
+        job = &work;
+    }
+
+    {
+        CPU_PROFILE_ZONE("strand chunks");
+        runChunks(0);
+    }
+
+    if(noOfWorkers > 1) {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobFinished.wait(lock, [this]() { return workersInJob == 0; });
+    }
+    job = nullptr;
+    elapsedSeconds += secondsSince(start);
+}
+
+void StrandScheduler::workerLoop(int worker)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "strand worker %d", worker);
+    CpuProfiler::setThreadName(name);
+    long seenGeneration = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobStarted.wait(lock, [&]() { return quit || jobGeneration != seenGeneration; });
+            if(quit)
+                return;
+            seenGeneration = jobGeneration;
+        }
+        {
+            CPU_PROFILE_ZONE("strand chunks");
+            runChunks(worker);
+        }
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            if(--workersInJob == 0)
+                jobFinished.notify_one();
+        }
+    }
+}
+
+void StrandScheduler::runChunks(int worker)
+{
+    StrandWorkerStats& stats = workers[worker]->stats;
+    Chunk chunk;
+    while(true) {
+        bool stolen = false;
+        if(!popChunk(worker, chunk)) {
+            if(!stealChunk(worker, chunk))
+                return; // every queue is empty, the remaining chunks are in flight
+            stolen = true;
+        }
+        auto start = std::chrono::steady_clock::now();
+        (*job)(chunk.first, chunk.last, worker);
+        stats.busySeconds += secondsSince(start);
+        stats.chunks++;
+        if(stolen)
+            stats.stolenChunks++;
+    }
+}
+
+bool StrandScheduler::popChunk(int worker, Chunk& chunk)
+{
+    Worker& own = *workers[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if(own.chunks.empty())
+        return false;
+    chunk = own.chunks.front();
+    own.chunks.pop_front();
+    return true;
+}
+
+bool StrandScheduler::stealChunk(int worker, Chunk& chunk)
+{
+    // Take from the far end of the victim's run, away from where it is working
+    int noOfWorkers = (int)workers.size();
+    for(int i = 1; i < noOfWorkers; i++) {
+        Worker& victim = *workers[(worker + i) % noOfWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.chunks.empty()) {
+            chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void StrandScheduler::resetStats()
+{
+    for(Worker* worker : workers)
+        worker->stats = StrandWorkerStats();
+    elapsedSeconds = 0.0;
+}
+
+void StrandScheduler::printUtilisation(std::ostream& out) const
+{
+    char line[128];
+    snprintf(line, sizeof(line), "%-8s %12s %10s %10s %10s\n", "worker", "busy (ms)", "util", "chunks", "stolen");
+    out << line;
+    for(size_t w = 0; w < workers.size(); w++) {
+        const StrandWorkerStats& stats = workers[w]->stats;
+        double utilisation = elapsedSeconds > 0.0 ? stats.busySeconds / elapsedSeconds : 0.0;
+        snprintf(line, sizeof(line), "%-8d %12.2f %9.1f%% %10ld %10ld\n", (int)w, stats.busySeconds * 1000.0,
+                 utilisation * 100.0, stats.chunks, stats.stolenChunks);
+        out << line;
+    }
+}
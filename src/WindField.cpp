@@ -0,0 +1,53 @@
+#include "WindField.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include <gtc/matrix_transform.hpp>
+
+
+WindField::WindField(int resolution)
+    : resolution(std::max(resolution, 2)), textureMatrix(1.f), gustOffset(0.f), updateTime(0.f)
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA16F, this->resolution, this->resolution, this->resolution);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+WindField::~WindField()
+{
+    glDeleteTextures(1, &texture);
+}
+
+void WindField::dispatchUpdate(ComputeShader& windShader, const glm::vec3& lower, const glm::vec3& upper,
+                               const glm::vec3& meanWind, float time)
+{
+    // integrated, so that the gusts keep their place when the mean wind changes
+    gustOffset += meanWind * std::max(time - updateTime, 0.f);
+    updateTime = time;
+
+    glm::vec3 size = glm::max(upper - lower, glm::vec3(FLT_MIN));
+    textureMatrix = glm::scale(glm::mat4(1.f), 1.f / size) * glm::translate(glm::mat4(1.f), -lower);
+
+    glBindImageTexture(0, texture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    windShader.use();
+    windShader.setInt("resolution", resolution);
+    windShader.setVec3("fieldOrigin", lower);
+    windShader.setVec3("cellSize", size / float(resolution));
+    windShader.setVec3("meanWind", meanWind);
+    windShader.setVec3("gustOffset", gustOffset);
+    int groups = (resolution + updateGroupSize - 1) / updateGroupSize;
+    glDispatchCompute(groups, groups, groups);
+}
+
+void WindField::bind(int textureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_3D, texture);
+}